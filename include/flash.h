@@ -7,14 +7,31 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include "gpNvm.h"
 
-void MemoryInit(void);
+// Number of independent banks simulated, each one is a separate device
+#define FLASH_BANKS 4
+
+// Default geometry of every bank
+#define FLASH_START 0x80000
+#define FLASH_SIZE 0x2000 // 8192 bytes (address 0x0000 to 0x2000)
+#define FLASH_PAGE_SIZE 0x800
 
-uint8_t flashWrite(uint8_t * addr, uint8_t * data, uint16_t len);
+// Simulated drivers, one per bank. Geometry follows last memory initialization
+extern gpNvm_FlashDriver FlashDrivers[FLASH_BANKS];
 
-uint8_t flashErasePage(uint8_t * addr);
+// Erase all banks with default geometry, bank 0 is persisted in text file
+void MemoryInit(void);
+
+// Erase first <banks> banks with given geometry, kept in RAM only
+void MemoryInitGeometry(uint16_t pageSize, uint32_t pageCount, uint8_t banks);
 
 void readFromFile(void);
 void saveMemoryToFile(void);
 
-uint8_t flashReadData(uint8_t * addr, uint8_t * data, uint16_t length);
\ No newline at end of file
+// Simulated time elapsed since MemoryInit() in nanoseconds
+uint64_t flashGetTime(void);
+
+// Number of erase and program operations in all banks since MemoryInit()
+void flashGetCounters(uint32_t * erases, uint32_t * programs);
@@ -5,14 +5,63 @@
  * Description: [Non-volatile memory storage component]
  *
  * Copyright (c) 2024 Maciej Sliwinski. All rights reserved.
- * 
+ *
  * This software is provided "as is" without any warranties.
  */
 
+#ifndef GPNVM_H
+#define GPNVM_H
+
+#include <stdint.h>
+
 typedef unsigned char UInt8;
-typedef UInt8 gpNvm_AttrId;
+typedef uint16_t gpNvm_AttrId;
 typedef UInt8 gpNvm_Result;
+typedef UInt8 gpNvm_PageHealth;
+
+// Page health reported by gpNvm_VerifyAll()
+enum {
+    GPNVM_PAGE_OK = 0,
+    GPNVM_PAGE_CORRECTED,       // Single bit error was fixed and page written back
+    GPNVM_PAGE_PARITY_CORRECTED,// Single bit error in parity bits, only parity written back
+    GPNVM_PAGE_UNCORRECTABLE,   // Double bit error detected, cannot be located
+    GPNVM_PAGE_READ_ERR,
+};
+
+/**
+ * Flash driver interface. One instance describes one independent flash bank.
+ * Program and erase may return before the operation completes, a read of a busy
+ * bank must wait for outstanding operations on that bank. Sync waits for all of them.
+ * Reads of idle bank may be issued from several threads at once (gpNvm_VerifyAll).
+ */
+typedef struct {
+    void * ctx;                 // Driver instance, passed back to every operation
+    UInt8 * flashStart;         // First address of the bank
+    uint32_t pageCount;         // Number of erasable pages in the bank
+    uint16_t pageSize;          // Size of single erasable page
+    UInt8 (*read)(void * ctx, UInt8 * addr, UInt8 * data, uint16_t length);
+    UInt8 (*program)(void * ctx, UInt8 * addr, UInt8 * data, uint16_t length);
+    UInt8 (*erase)(void * ctx, UInt8 * addr);
+    UInt8 (*sync)(void * ctx);
+} gpNvm_FlashDriver;
+
+gpNvm_Result gpNvm_Init(const gpNvm_FlashDriver * banks, UInt8 bankCount);
+
+gpNvm_Result gpNvm_Sync(void);
+
+gpNvm_Result gpNvm_Flush(void);
+
+gpNvm_Result gpNvm_ConfigureWriteCache(uint32_t holdTime, uint16_t dirtyLimit);
+
+gpNvm_Result gpNvm_Process(uint32_t now);
+
+uint32_t gpNvm_GetPageCount(void);
+
+gpNvm_Result gpNvm_VerifyAll(UInt8 threads, gpNvm_PageHealth * pReport, uint32_t reportLength);
+gpNvm_Result gpNvm_ErasePage(uint32_t logicalPage);
 
 gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue);
 
-gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue);
\ No newline at end of file
+gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue);
+
+#endif /* GPNVM_H */
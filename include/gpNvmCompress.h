@@ -0,0 +1,32 @@
+/**
+ **********************************************************************************
+ * File: [gpNvmCompress.h]
+ * Author: [Maciej Sliwinski]
+ * Description: [Non-volatile memory storage component]
+ *
+ * This software is provided "as is" without any warranties.
+ */
+
+#ifndef GPNVM_COMPRESS_H
+#define GPNVM_COMPRESS_H
+
+#include <stdint.h>
+
+typedef unsigned char UInt8;
+
+// Compression mode of block, AUTO selects the codec giving smaller result
+enum {
+    GPNVM_COMPRESSION_NONE = 0,
+    GPNVM_COMPRESSION_RLE,
+    GPNVM_COMPRESSION_LZ,
+    GPNVM_COMPRESSION_AUTO,
+};
+
+// Encoders return encoded length, 0 when result does not fit in dstCapacity
+// Decoders return decoded length, 0 when input is malformed or does not fit in dstCapacity
+uint16_t compressRle(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity);
+uint16_t decompressRle(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity);
+uint16_t compressLz(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity);
+uint16_t decompressLz(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity);
+
+#endif /* GPNVM_COMPRESS_H */
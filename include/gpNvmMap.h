@@ -11,32 +11,53 @@
 
 #include <stdlib.h>
 #include "gpNvm.h"
+#include "gpNvmCompress.h"
 
 // ******************************************
 // ****** PUT YOUR CODE HERE **** START *****
 // ******************************************
 
-#define GPNVM_FLASH_SIZE (0x1FFF)
-#define GPNVM_PAGE_SIZE (0x800)
+// Logical address of first page, block addresses are given relative to it.
+// Page size and number of pages are taken from flash driver at init
 #define GPNVM_FLASH_START (0x80000)
-#define GPNVM_FLASH_END (GPNVM_FLASH_START + GPNVM_FLASH_SIZE)
+// Largest page size supported, determines size of page buffers
+#define GPNVM_MAX_PAGE_SIZE (0x1000)
+// Attempts of erasing and programming page from its buffered image before failure is reported
+#define GPNVM_PROGRAM_ATTEMPTS (2)
 
 #define GPNVM_BLOCKS (3)
 
 #define GPNVM_USE_ECC
 
+#ifdef GPNVM_USE_ECC
+    // Placement of ECC region in every bank: GPNVM_ECC_AT_START or GPNVM_ECC_AT_END
+    #define GPNVM_ECC_PLACEMENT GPNVM_ECC_AT_END
+    // Pages reserved for ECC region in every bank, 0 derives minimal size from bank geometry
+    #define GPNVM_ECC_PAGES (0)
+#endif /* ifdef GPNVM_USE_ECC */
+
+#define GPNVM_USE_WRITE_CACHE
+
+#ifdef GPNVM_USE_WRITE_CACHE
+    // Entries of write cache pool, largest dirty limit accepted by gpNvm_ConfigureWriteCache()
+    #define GPNVM_CACHE_ENTRIES (8)
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+
+// Worker threads (pthreads) verify pages in gpNvm_VerifyAll()
+#define GPNVM_USE_THREADS
+
 // ******************************************
 // ****** PUT YOUR CODE HERE **** END *******
 // ******************************************
 
-#ifdef GPNVM_USE_ECC
-    #define GPNVM_SINGLE_PAGE_ECC_SIZE 2
-    #define GPNVM_ECC_BLOCK_ID GPNVM_BLOCKS
-#endif /* ifdef GPNVM_USE_ECC */
+#define GPNVM_ECC_AT_START 0
+#define GPNVM_ECC_AT_END 1
 
 typedef struct {
     UInt8 * startAddr;
     UInt8 length;
+    UInt8 compression;  // GPNVM_COMPRESSION_xxx, NONE when omitted
+    UInt8 maxLength;    // Longest value of compressed block (read buffer size), block length when omitted
 } gpNvmBlock;
 
-extern const gpNvmBlock GpNvmMap[];
+extern const gpNvmBlock GpNvmMap[GPNVM_BLOCKS];
@@ -7,10 +7,17 @@
  * This software is provided "as is" without any warranties.
  */
 
+#include <stdint.h>
+
 typedef unsigned char UInt8;
-typedef UInt8 gpNvm_AttrId;
-typedef UInt8 gpNvm_Result;
 
-void calculateParityBits(UInt8 *data, UInt8 *parity);
-UInt8 decodeAndCorrect(UInt8 *data, UInt8 *parity);
-void storeParityExternally(UInt8 *parity);
\ No newline at end of file
+// Returned by decodeAndCorrect() when error cannot be located (e.g. double error)
+#define HAMMING_UNCORRECTABLE 0xFFFFFFFFUL
+// Returned by decodeAndCorrect() when single error was in parity bits, data is intact
+#define HAMMING_PARITY_CORRECTED 0xFFFFFFFEUL
+
+UInt8 getParityBits(uint32_t dataSize);
+UInt8 getParitySize(uint32_t dataSize);
+void calculateParityBits(UInt8 *data, uint32_t dataSize, UInt8 *parity);
+uint32_t decodeAndCorrect(UInt8 *data, uint32_t dataSize, UInt8 *parity);
+void storeParityExternally(UInt8 *parity, uint32_t dataSize);
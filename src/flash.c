@@ -14,10 +14,13 @@
 
 #define FILENAME "flash.txt"
 
-#define FLASH_SIZE 0x2000 // 8192 bytes (address 0x0000 to 0x2000)
-#define PAGE_SIZE 0x800
-#define FLASH_START 0x80000
-#define FLASH_END FLASH_START + FLASH_SIZE
+// End of bank for current geometry
+#define FLASH_END (FLASH_START + flashSize)
+
+// Simulated operation timings in nanoseconds
+#define FLASH_READ_TIME_PER_BYTE 25
+#define FLASH_PROGRAM_TIME_PER_BYTE 10000
+#define FLASH_ERASE_TIME 20000000
 
 typedef enum {
     FLASH_OK = 0,
@@ -26,12 +29,52 @@ typedef enum {
     FLASH_OUT_OF_BOUNDS,
 } FlashStatus;
 
-uint8_t Memory[FLASH_SIZE];
+typedef struct {
+    uint8_t * memory;       // Storage of the bank
+    uint64_t busyUntil;     // Simulated time when last queued operation completes
+} FlashBank;
+
+// Banks are stored one after another, bank 0 first
+uint8_t * Memory = NULL;
+
+static FlashBank flashBanks[FLASH_BANKS];
+
+// Current geometry of every bank
+static uint32_t flashSize = FLASH_SIZE;
+static uint16_t flashPageSize = FLASH_PAGE_SIZE;
+// Only default geometry is persisted in text file
+static bool flashPersistent = true;
+
+// Simulated time, host is blocked only while waiting for a busy bank.
+// Idle banks may be read from several threads, so time is accessed atomically only
+static uint64_t flashTime = 0;
+// Operations issued in all banks
+static uint32_t flashEraseCount = 0;
+static uint32_t flashProgramCount = 0;
 
 static const char * filename = "flash.txt";
 
-static uint8_t * getMemoryAddr(uint8_t * addr) {
-    return &Memory[(uintptr_t)addr - FLASH_START];
+static uint8_t * getMemoryAddr(FlashBank * bank, uint8_t * addr) {
+    return &bank->memory[(uintptr_t)addr - FLASH_START];
+}
+
+static uint64_t getTime(void) {
+    return __atomic_load_n(&flashTime, __ATOMIC_RELAXED);
+}
+
+static void waitForBank(FlashBank * bank) {
+    uint64_t now = getTime();
+    // Time only moves forward, another thread may advance it meanwhile
+    while(bank->busyUntil > now &&
+            !__atomic_compare_exchange_n(&flashTime, &now, bank->busyUntil, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Program and erase are issued by single thread, while no other thread reads
+static void queueOperation(FlashBank * bank, uint64_t duration) {
+    uint64_t now = getTime();
+    uint64_t start = bank->busyUntil > now ? bank->busyUntil : now;
+    bank->busyUntil = start + duration;
 }
 
 static void parse_memory_line(const char *line, uint8_t memory[], size_t base_address) {
@@ -46,7 +89,21 @@ static void parse_memory_line(const char *line, uint8_t memory[], size_t base_ad
     }
 }
 
+static void allocateMemory(uint16_t pageSize, uint32_t pageCount, uint8_t banks) {
+    flashPageSize = pageSize;
+    flashSize = (uint32_t)pageSize * pageCount;
+    Memory = realloc(Memory, (size_t)flashSize * banks);
+    for(uint8_t i = 0; i < FLASH_BANKS; i++) {
+        flashBanks[i].memory = i < banks ? &Memory[(size_t)i * flashSize] : NULL;
+        FlashDrivers[i].pageSize = pageSize;
+        FlashDrivers[i].pageCount = i < banks ? pageCount : 0;
+    }
+}
+
 void readFromFile(void) {
+    if (Memory == NULL) {
+        allocateMemory(FLASH_PAGE_SIZE, FLASH_SIZE / FLASH_PAGE_SIZE, FLASH_BANKS);
+    }
     FILE *file = fopen(filename, "r");
     if (file == NULL) {
         perror("Error opening file");
@@ -70,6 +127,9 @@ void readFromFile(void) {
 
 void saveMemoryToFile(void)
 {
+    if (!flashPersistent || Memory == NULL) {
+        return;
+    }
     // Open the file in write mode
     FILE *file = fopen(filename, "w");
     if (file == NULL) {
@@ -94,12 +154,11 @@ void saveMemoryToFile(void)
     fclose(file);
 }
 
-static bool isPageErased(uint8_t * addr) {
+static bool isRangeErased(FlashBank * bank, uint8_t * addr, uint16_t len) {
     bool status = true;
-    uint32_t pageStart = ((uintptr_t)addr / PAGE_SIZE) * PAGE_SIZE;
-    for(uint32_t i = 0; i < PAGE_SIZE ; i++)
+    for(uint32_t i = 0; i < len ; i++)
     {
-        if(Memory[pageStart - FLASH_START] != 0xFF) {
+        if(getMemoryAddr(bank, addr)[i] != 0xFF) {
             status = false;
             break; 
         }
@@ -107,49 +166,79 @@ static bool isPageErased(uint8_t * addr) {
     return status;
 }
 
+void MemoryInitGeometry(uint16_t pageSize, uint32_t pageCount, uint8_t banks) {
+    allocateMemory(pageSize, pageCount, banks);
+    memset(Memory, 0xFF, (size_t)flashSize * banks);
+    for(uint8_t i = 0; i < FLASH_BANKS; i++) {
+        flashBanks[i].busyUntil = 0;
+    }
+    __atomic_store_n(&flashTime, 0, __ATOMIC_RELAXED);
+    flashEraseCount = 0;
+    flashProgramCount = 0;
+    flashPersistent = false;
+}
+
 void MemoryInit(void) {
-    memset(Memory, 0xFF, sizeof(Memory));
+    MemoryInitGeometry(FLASH_PAGE_SIZE, FLASH_SIZE / FLASH_PAGE_SIZE, FLASH_BANKS);
+    flashPersistent = true;
     saveMemoryToFile();
 }
 
-uint8_t flashWrite(uint8_t * addr, uint8_t * data, uint16_t len) {
+uint64_t flashGetTime(void) {
+    return getTime();
+}
+
+void flashGetCounters(uint32_t * erases, uint32_t * programs) {
+    *erases = flashEraseCount;
+    *programs = flashProgramCount;
+}
+
+static uint8_t flashWrite(void * ctx, uint8_t * addr, uint8_t * data, uint16_t len) {
+    FlashBank * bank = (FlashBank *)ctx;
     FlashStatus status = FLASH_OK;
-    if(!isPageErased(addr) || !isPageErased((uint8_t *)(((uintptr_t)addr+(uintptr_t)len - 1)))) {
-        status = FLASH_PAGE_NOT_ERASED;
-    }
     if(addr == NULL || data == NULL || len == 0) {
         status = FLASH_PARAM_ERR;
     }
-    if((uintptr_t) addr > FLASH_END || (uintptr_t)addr < FLASH_START) {
+    if((uintptr_t) addr >= FLASH_END || (uintptr_t)addr < FLASH_START) {
         status = FLASH_OUT_OF_BOUNDS;
     }
+    if(((uintptr_t)addr + (uintptr_t)len) > FLASH_END) {
+        status = FLASH_OUT_OF_BOUNDS;
+    }
+    // Programmed area must be erased, page may be programmed in several steps
+    if(status == FLASH_OK && !isRangeErased(bank, addr, len)) {
+        status = FLASH_PAGE_NOT_ERASED;
+    }
 
     if (status == FLASH_OK) {
-        memcpy(getMemoryAddr(addr), data, len);
+        // Data is visible right away, bank stays busy until program time elapses
+        memcpy(getMemoryAddr(bank, addr), data, len);
+        queueOperation(bank, (uint64_t)len * FLASH_PROGRAM_TIME_PER_BYTE);
+        flashProgramCount++;
     }
-
-    saveMemoryToFile();
     return (uint8_t)status;
 }
 
-uint8_t flashErasePage(uint8_t * addr) {
+static uint8_t flashErasePage(void * ctx, uint8_t * addr) {
+    FlashBank * bank = (FlashBank *)ctx;
     FlashStatus status = FLASH_OK;
     if(addr == NULL) {
         status = FLASH_PARAM_ERR;
     }
-    if((uintptr_t) addr > FLASH_END || (uintptr_t)addr < FLASH_START) {
+    if((uintptr_t) addr >= FLASH_END || (uintptr_t)addr < FLASH_START) {
         status = FLASH_OUT_OF_BOUNDS;
     }
     if(status == FLASH_OK) {
-        uint32_t pageStart = ((uintptr_t)addr / PAGE_SIZE) * PAGE_SIZE;
-        memset(getMemoryAddr((uint8_t *)pageStart), 0xFF, PAGE_SIZE);
+        uintptr_t pageStart = FLASH_START + (((uintptr_t)addr - FLASH_START) / flashPageSize) * flashPageSize;
+        memset(getMemoryAddr(bank, (uint8_t *)pageStart), 0xFF, flashPageSize);
+        queueOperation(bank, FLASH_ERASE_TIME);
+        flashEraseCount++;
     }
-
-    saveMemoryToFile();
     return status;
 }
 
-uint8_t flashReadData(uint8_t * addr, uint8_t * data, uint16_t length) {
+static uint8_t flashReadData(void * ctx, uint8_t * addr, uint8_t * data, uint16_t length) {
+    FlashBank * bank = (FlashBank *)ctx;
     FlashStatus status = FLASH_OK;
     if(addr == NULL || data == NULL || length == 0) {
         status = FLASH_PARAM_ERR;
@@ -159,7 +248,37 @@ uint8_t flashReadData(uint8_t * addr, uint8_t * data, uint16_t length) {
         status = FLASH_OUT_OF_BOUNDS;
     }
     if(status == FLASH_OK) {
-        memcpy(data, getMemoryAddr(addr), length);
+        waitForBank(bank);
+        memcpy(data, getMemoryAddr(bank, addr), length);
+        // Single atomic add per read, page sized reads keep contention low
+        __atomic_fetch_add(&flashTime, (uint64_t)length * FLASH_READ_TIME_PER_BYTE, __ATOMIC_RELAXED);
     }
     return status;
-}
\ No newline at end of file
+}
+
+static uint8_t flashSync(void * ctx) {
+    FlashBank * bank = (FlashBank *)ctx;
+    waitForBank(bank);
+    if(bank == &flashBanks[0]) {
+        saveMemoryToFile();
+    }
+    return FLASH_OK;
+}
+
+#define FLASH_DRIVER(bankNo) {                      \
+    .ctx = &flashBanks[bankNo],                     \
+    .flashStart = (uint8_t *)FLASH_START,           \
+    .pageCount = FLASH_SIZE / FLASH_PAGE_SIZE,      \
+    .pageSize = FLASH_PAGE_SIZE,                    \
+    .read = flashReadData,                          \
+    .program = flashWrite,                          \
+    .erase = flashErasePage,                        \
+    .sync = flashSync,                              \
+}
+
+gpNvm_FlashDriver FlashDrivers[FLASH_BANKS] = {
+    FLASH_DRIVER(0),
+    FLASH_DRIVER(1),
+    FLASH_DRIVER(2),
+    FLASH_DRIVER(3),
+};
@@ -26,19 +26,56 @@
             - Not overlapping blocks
             - Length limited to size of 0xFF
             - One block cannot extend beyond one flash memory page
-            - Defining properties of your flash memory: SIZE, PAGE_SIZE, FLASH_START, NUMBER_OF_BLOCKS
+            - Defining logical start address of blocks, largest page size and NUMBER_OF_BLOCKS
+        Page size and number of pages are taken from flash drivers at init, the map is verified
+        against them. Attribute ID is 16-bit.
         ID of a block is its position in map array, thus be careful when referring to block ID.
         Example configuration is available.
-    [] ECC mechanism can be enabled (optional) which uses Hamming code to detect and correct single-bit
-        errors. ECC works page-wise and its contents are stored in the last 0x100 bytes of flash memory,
-        thus user-defined block cannot be defined in this area.
+    [] Flash is accessed through gpNvm_FlashDriver passed to gpNvm_Init(). Several drivers (banks)
+        can be given, consecutive pages of the map are then interleaved over banks (page N resides
+        in bank N % bankCount), so erases and programs of pages in different banks overlap in time.
+        All banks must have the same page size, the smallest bank limits number of pages used.
+    [] ECC mechanism can be enabled (optional) which uses Hamming code with overall parity bit (SECDED)
+        to correct single-bit and detect double-bit errors. Parity bits are covered as well, error in
+        them rewrites parity only. Get and set of attribute residing in page with uncorrectable
+        error fail, so corrupted data is neither returned nor covered with new parity.
+        ECC works page-wise, parity width is derived from page size. Parity is stored in ECC region of
+        whole pages reserved at the end (or start, GPNVM_ECC_PLACEMENT) of every bank, which is
+        excluded from logical address space. ECC page holds pageSize / paritySize whole entries, so no
+        entry crosses page boundary. Region size (GPNVM_ECC_PAGES) is derived from bank geometry
+        by default. Every bank keeps parity of its own pages, so parity updates do not serialize banks.
+        Page never programmed (page and its parity erased) is considered valid.
+    [] Failed page program is repeated from erase (GPNVM_PROGRAM_ATTEMPTS). Erased parity of programmed
+        page (ECC page update failed) is regenerated from data, parity updated before failed program
+        of data page is matched back to page contents, so failure does not break other pages.
+    [] gpNvm_VerifyAll() checks every page at once, e.g. at boot, instead of finding errors lazily
+        on first access. Pages are split over a pool of worker threads (GPNVM_USE_THREADS, drivers
+        must allow concurrent reads of idle banks), corrected pages are written back afterwards with
+        parity updates batched per ECC page. Health of every logical page is reported.
+    [] gpNvm_ErasePage() recovers page reported uncorrectable, page and its parity are erased
+        and blocks of the page read back erased.
+    [] Block can be configured with compression (RLE, LZ or AUTO picking smaller of the two).
+        Compressed block holds 2 bytes header (codec used, stored length) followed by encoded value,
+        value is stored raw when compression does not pay off. Value up to maxLength of the block
+        (block length when omitted, at most 0xFF) can be set as long as it fits in the block after
+        encoding, read buffer must hold maxLength bytes.
+        Unused part of block is left erased and is not programmed. Compression saves programmed
+        bytes only, every set still erases and reprograms the whole page.
+    [] Write cache can be enabled (optional) with gpNvm_ConfigureWriteCache(). Set values are then
+        held in RAM and only the latest one is programmed, once it was held for hold time (checked
+        in gpNvm_Process()) or when dirty limit of attributes is exceeded. Dirty blocks sharing page
+        are programmed together. gpNvm_Flush() programs everything and waits for completion.
+        Values are held in pool of GPNVM_CACHE_ENTRIES entries, which limits dirty limit as well.
+        Lowering dirty limit programs oldest values until it is met.
  */
 
 #include <string.h>
 #include "gpNvm.h"
 #include "gpNvmMap.h"
-#include "flash.h"
 #include "hamming.h"
+#ifdef GPNVM_USE_THREADS
+#include <pthread.h>
+#endif /* ifdef GPNVM_USE_THREADS */
 
 enum {
     GPNVM_OK = 0,
@@ -46,177 +83,1147 @@ enum {
     GPNVM_PARAM_ERR,
     GPNVM_OUT_OF_BOUNDS,
     GPNVM_INCORRECT_ID,
+    GPNVM_NOT_INITIALIZED,
+    GPNVM_COMPRESSION_ERR,
+    GPNVM_ECC_ERR,
 } gpNvmStatus;
 
-enum {
-    ECC_SCAN_AND_FIX,
-    ECC_UPDATE_PARITY,
-} eccOperation;
+// Compressed block header: codec used and length of stored (encoded) value
+#define GPNVM_COMPRESSION_HEADER_SIZE 2
+// Maximal value length of compressed block
+#define GPNVM_MAX_VALUE_LENGTH 0xFF
+// Parity of page up to 4 GB
+#define GPNVM_MAX_PARITY_SIZE 4
+// Program granularity, fully erased chunks of page are not programmed
+#define GPNVM_PROGRAM_CHUNK 16
+
+// Page of a bank, physical location of logical page
+typedef struct {
+    const gpNvm_FlashDriver * bank;
+    UInt8 * pageStart;
+    uint32_t pageNo;        // Index among data pages of bank
+} gpNvmPage;
+
+// Geometry derived from flash drivers at init, identical for every bank
+typedef struct {
+    uint16_t pageSize;
+    uint32_t dataPages;     // Pages of bank available for blocks
+    uint32_t firstDataPage; // Index of first data page within bank
+#ifdef GPNVM_USE_ECC
+    UInt8 paritySize;       // Bytes of parity of single page
+    uint16_t parityPerPage; // Parity entries in ECC page, no entry crosses page boundary
+    uint32_t eccOffset;     // Offset of ECC region from bank start
+#endif /* ifdef GPNVM_USE_ECC */
+} gpNvmGeometry;
+
+#ifdef GPNVM_USE_WRITE_CACHE
+// Block contents held in RAM until programmed, entry is in use while dirty
+typedef struct {
+    gpNvm_AttrId attrId;    // Block held by the entry
+    UInt8 image[GPNVM_MAX_VALUE_LENGTH];
+    UInt8 length;           // Bytes from block start to be programmed
+    UInt8 dirty;            // Contents not programmed yet
+    uint32_t since;         // Time of first write absorbed
+} gpNvmCacheEntry;
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+
+#ifdef GPNVM_USE_ECC
+// Range of logical pages verified by single worker
+typedef struct {
+    uint32_t firstPage;
+    uint32_t endPage;
+    gpNvm_PageHealth * pReport;
+} gpNvmVerifyJob;
+
+// Most workers of gpNvm_VerifyAll()
+#define GPNVM_MAX_VERIFY_THREADS 32
+#endif /* ifdef GPNVM_USE_ECC */
 
 // ---------------------- GLOBAL VARIABLES ----------------------
 // Map of blocks
 static gpNvmBlock * const GpNvmBlocks = (gpNvmBlock * const)GpNvmMap;
+// Flash banks logical pages are interleaved over
+static const gpNvm_FlashDriver * GpNvmBanks = NULL;
+static UInt8 GpNvmBankCount = 0;
+static gpNvmGeometry GpNvmGeometry;
+
+#ifdef GPNVM_USE_WRITE_CACHE
+// Write cache, pool of entries shared by all blocks
+static gpNvmCacheEntry GpNvmCache[GPNVM_CACHE_ENTRIES];
+static uint16_t GpNvmCacheDirtyCount = 0;
+static uint16_t GpNvmCacheDirtyLimit = 0;
+static uint32_t GpNvmCacheHoldTime = 0;
+// Last time passed to gpNvm_Process()
+static uint32_t GpNvmCacheTime = 0;
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
 
 // ---------------------- LOCAL FUNCTIONS ----------------------
-static gpNvm_Result gpNvm_WriteFlash(UInt8 * addr, uint16_t length, UInt8* pValue);
-static UInt8 * gpNvm_GetPageStartAddr(gpNvm_AttrId attrId);
+static gpNvmPage gpNvm_GetLogicalPage(uint32_t logicalPage);
+static gpNvmPage gpNvm_GetPage(gpNvm_AttrId attrId);
+static gpNvm_Result gpNvm_ReadPage(const gpNvmPage * page, UInt8 * pageBuffer);
+static gpNvm_Result gpNvm_ProgramPageOnce(const gpNvmPage * page, UInt8 * pageBuffer);
+static gpNvm_Result gpNvm_ProgramPage(const gpNvmPage * page, UInt8 * pageBuffer);
+static gpNvm_Result gpNvm_EncodeBlock(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue, UInt8 * pBlock);
+static gpNvm_Result gpNvm_DecodeBlock(gpNvm_AttrId attrId, UInt8 * pBlock, UInt8* pLength, UInt8* pValue);
+static uint16_t gpNvm_GetBlockOffset(gpNvm_AttrId attrId);
+static UInt8 gpNvm_GetMaxValueLength(gpNvm_AttrId attrId);
+static UInt8 gpNvm_GetImageLength(gpNvm_AttrId attrId, UInt8 length);
+static gpNvm_Result gpNvm_WriteBlock(gpNvm_AttrId attrId, UInt8 * pImage, UInt8 imageLength);
+
+#ifdef GPNVM_USE_WRITE_CACHE
+static uintptr_t cacheGetLogicalPage(gpNvm_AttrId attrId);
+static gpNvmCacheEntry * cacheFind(gpNvm_AttrId attrId);
+static void cacheOverlayPage(gpNvm_AttrId attrId, UInt8 * pageBuffer);
+static void cacheMarkPageClean(gpNvm_AttrId attrId);
+static gpNvm_Result cacheFlushEntry(gpNvmCacheEntry * entry);
+static gpNvm_Result cacheFlushExpired(UInt8 all);
+static gpNvm_Result cacheFlushOldest(void);
+static gpNvm_Result cacheStore(gpNvm_AttrId attrId, UInt8 * pImage, UInt8 imageLength);
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
 
 #ifdef GPNVM_USE_ECC
-static UInt8 * eccGetPageParityAddr(gpNvm_AttrId attrId);
-static void eccUpdate(gpNvm_AttrId attrId, UInt8 operation);
+static gpNvm_Result gpNvm_WriteFlash(const gpNvm_FlashDriver * bank, UInt8 * addr, uint16_t length, UInt8* pValue);
+static UInt8 * eccGetPageParityAddr(const gpNvmPage * page);
+static gpNvm_Result eccScanAndFix(const gpNvmPage * page, UInt8 * pageBuffer);
+static gpNvm_Result eccUpdateParity(const gpNvmPage * page, UInt8 * pageBuffer);
+static void eccRestoreParity(const gpNvmPage * page, UInt8 * pageBuffer);
+static UInt8 eccIsErased(const UInt8 * data, uint32_t length);
+static gpNvm_PageHealth eccVerifyPage(const gpNvmPage * page, UInt8 * pageBuffer, UInt8 * pParity);
+static void * eccVerifyWorker(void * arg);
+static gpNvm_Result eccWriteBackCorrected(const gpNvm_PageHealth * pReport);
 #endif /* ifdef GPNVM_USE_ECC */
 
 // ---------------------- FUNCTION DEFINITIONS ----------------------
 
-#ifdef GPNVM_USE_ECC
-static UInt8 * eccGetPageParityAddr(gpNvm_AttrId attrId) {
-    UInt8 * pageStart = gpNvm_GetPageStartAddr(attrId);
-    UInt8 pageNo = (((int)pageStart - GPNVM_FLASH_START) / GPNVM_PAGE_SIZE);
-    UInt8 * parityAddr = (UInt8 *)(GpNvmBlocks[GPNVM_ECC_BLOCK_ID].startAddr + 
-                                        (pageNo * GPNVM_SINGLE_PAGE_ECC_SIZE));
-    return parityAddr;
+/**
+ * @brief Gets physical page of logical page
+ * @param logicalPage page number in logical address space
+ * @return Bank and start address of page within bank
+ */
+static gpNvmPage gpNvm_GetLogicalPage(uint32_t logicalPage) {
+    gpNvmPage page;
+    page.bank = &GpNvmBanks[logicalPage % GpNvmBankCount];
+    page.pageNo = logicalPage / GpNvmBankCount;
+    page.pageStart = page.bank->flashStart +
+                        (uintptr_t)(GpNvmGeometry.firstDataPage + page.pageNo) * GpNvmGeometry.pageSize;
+    return page;
 }
 
 /**
- * @brief Gets start address of page
+ * @brief Gets physical page where attrId belongs to
  * @param attrId data of interest
- * @return Pointer to start address of page where attrId belongs to
+ * @return Bank and start address of page within bank
+ */
+static gpNvmPage gpNvm_GetPage(gpNvm_AttrId attrId) {
+    uintptr_t logicalPage = ((uintptr_t)GpNvmBlocks[attrId].startAddr - GPNVM_FLASH_START) / GpNvmGeometry.pageSize;
+    return gpNvm_GetLogicalPage((uint32_t)logicalPage);
+}
+
+#ifdef GPNVM_USE_ECC
+/**
+ * @brief Gets address of parity bits of page. Parity is kept in the bank of the page,
+ *        every ECC page holds whole entries only
+ * @param page page of interest
+ * @return Pointer to parity bits within bank
  */
-static UInt8 * gpNvm_GetPageStartAddr(gpNvm_AttrId attrId) {
-    return (UInt8 *)(((int)GpNvmBlocks[attrId].startAddr / GPNVM_PAGE_SIZE) * GPNVM_PAGE_SIZE);
+static UInt8 * eccGetPageParityAddr(const gpNvmPage * page) {
+    return page->bank->flashStart + GpNvmGeometry.eccOffset +
+                (uintptr_t)(page->pageNo / GpNvmGeometry.parityPerPage) * GpNvmGeometry.pageSize +
+                (uintptr_t)(page->pageNo % GpNvmGeometry.parityPerPage) * GpNvmGeometry.paritySize;
 }
 
 /**
- * @brief Update ECC data based on hamming code. ECC works flash page-wise
- * @param attrId desired block of data to be verified
- * @param operation type of operation (scan&fix verifies and fixes content
- *                  and update parity recalculates data from memory and updates parity data)
+ * @brief Verify page read into buffer against its parity bits and fix single bit error
+ *        in both buffer and flash memory
+ * @param page page read into buffer
+ * @param pageBuffer page contents
+ * @return gpNvm_Result result of operation, GPNVM_ECC_ERR if error cannot be corrected
  */
-static void eccUpdate(gpNvm_AttrId attrId, UInt8 operation) {
-    UInt8 * pageStart = gpNvm_GetPageStartAddr(attrId);
-    UInt8 res;
-    // Parity data calculated from memory
-    UInt8 calculatedParity[GPNVM_SINGLE_PAGE_ECC_SIZE] = {0};
+static gpNvm_Result eccScanAndFix(const gpNvmPage * page, UInt8 * pageBuffer) {
+    gpNvm_Result res = GPNVM_OK;
     // Parity data read from memory
-    UInt8 readParity[GPNVM_SINGLE_PAGE_ECC_SIZE] = {0};
-    // Buffer holding page data
-    UInt8 gpNvmBuffer[GPNVM_PAGE_SIZE] = {0};
-    // Address of parity bits storage for page
-    UInt8 * parityAddr = eccGetPageParityAddr(attrId);
-    
-    // Page backup
-    res = flashReadData((UInt8 *)pageStart, gpNvmBuffer, GPNVM_PAGE_SIZE);
-    if(operation == ECC_SCAN_AND_FIX) {
-        // Read parity bits from memory
-        flashReadData(parityAddr, readParity, 2);
+    UInt8 readParity[GPNVM_MAX_PARITY_SIZE] = {0};
+
+    res = page->bank->read(page->bank->ctx, eccGetPageParityAddr(page), readParity, GpNvmGeometry.paritySize);
+    if(res == GPNVM_OK) {
         // Check data integrity
-        if(decodeAndCorrect(gpNvmBuffer, readParity) != GPNVM_OK) {
-            // Error detected and corrected
-            // Calculate new parity bits for corrected memory data
-            calculateParityBits(gpNvmBuffer, calculatedParity);
-            // Write corrected parity bits
-            res = gpNvm_WriteFlash(parityAddr, sizeof(calculatedParity), calculatedParity);
-            if(res == GPNVM_OK) {
-                // Write corrected page
-                res = gpNvm_WriteFlash((UInt8 *)pageStart, GPNVM_PAGE_SIZE, gpNvmBuffer);
+        gpNvm_PageHealth health = eccVerifyPage(page, pageBuffer, readParity);
+        if(health == GPNVM_PAGE_CORRECTED || health == GPNVM_PAGE_PARITY_CORRECTED) {
+            // Error detected and corrected, write corrected parity bits
+            res = eccUpdateParity(page, pageBuffer);
+        }
+        if(res == GPNVM_OK && health == GPNVM_PAGE_CORRECTED) {
+            // Data bit was flipped, rewrite page as well
+            res = gpNvm_ProgramPage(page, pageBuffer);
+            if(res != GPNVM_OK) {
+                eccRestoreParity(page, pageBuffer);
             }
         }
+        if(health == GPNVM_PAGE_UNCORRECTABLE) {
+            // Page contents cannot be trusted, neither returned nor used for new parity
+            res = GPNVM_ECC_ERR;
+        }
     }
-    else if (operation == ECC_UPDATE_PARITY) {
-        calculateParityBits(gpNvmBuffer, calculatedParity);
-        // Write new parity bits for corresponding page
-        storeParityExternally(calculatedParity);
-        res = gpNvm_WriteFlash(parityAddr, sizeof(calculatedParity), calculatedParity);
+    return res;
+}
+
+/**
+ * @brief Calculate parity bits of page contents and store them in flash memory.
+ *        Parity page is rewritten before the page itself, so no wait for page program is needed
+ * @param page page parity belongs to
+ * @param pageBuffer new page contents
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result eccUpdateParity(const gpNvmPage * page, UInt8 * pageBuffer) {
+    // Parity data calculated from page contents
+    UInt8 calculatedParity[GPNVM_MAX_PARITY_SIZE] = {0};
+
+    calculateParityBits(pageBuffer, GpNvmGeometry.pageSize, calculatedParity);
+    return gpNvm_WriteFlash(page->bank, eccGetPageParityAddr(page), GpNvmGeometry.paritySize, calculatedParity);
+}
+
+/**
+ * @brief Match parity to contents left in page after its program failed. Parity was
+ *        already updated for new contents, page would be uncorrectable otherwise
+ * @param page page which failed to be programmed
+ * @param pageBuffer buffer of page size, overwritten with contents read back
+ */
+static void eccRestoreParity(const gpNvmPage * page, UInt8 * pageBuffer) {
+    if(page->bank->read(page->bank->ctx, page->pageStart, pageBuffer, GpNvmGeometry.pageSize) == GPNVM_OK) {
+        // Program failure is reported by caller, parity is restored on best effort basis
+        (void)eccUpdateParity(page, pageBuffer);
     }
-    if(res != GPNVM_OK) {
-        // Callback
+}
+
+/**
+ * @brief Checks if memory holds erased bytes only
+ * @return 1 if every byte is 0xFF
+ */
+static UInt8 eccIsErased(const UInt8 * data, uint32_t length) {
+    for(uint32_t i = 0; i < length; i++) {
+        if(data[i] != 0xFF) {
+            return 0;
+        }
     }
+    return 1;
 }
-#endif /* ifdef GPNVM_USE_ECC */
 
 /**
- * @brief Reads <attrId> memory block
- * @param pLength Length of read block
- * @param pValue Buffer to copy read data
+ * @brief Verify page contents against parity bits, single bit error is fixed in buffers only.
+ *        Error in parity bits leaves page contents intact. Erased parity of programmed page
+ *        was lost by failed update of ECC page, it is reported to be regenerated from data
+ * @param page page read into buffer
+ * @param pageBuffer page contents
+ * @param pParity parity bits read from memory
+ * @return Health of page
+ */
+static gpNvm_PageHealth eccVerifyPage(const gpNvmPage * page, UInt8 * pageBuffer, UInt8 * pParity) {
+    uint32_t errorPos;
+    UInt8 calculatedParity[GPNVM_MAX_PARITY_SIZE] = {0};
+    (void)page;
+
+    if(eccIsErased(pParity, GpNvmGeometry.paritySize)) {
+        // Page which was never programmed has no parity
+        if(eccIsErased(pageBuffer, GpNvmGeometry.pageSize)) {
+            return GPNVM_PAGE_OK;
+        }
+        // Data cannot be checked against lost parity, it is trusted as is
+        calculateParityBits(pageBuffer, GpNvmGeometry.pageSize, calculatedParity);
+        if(!eccIsErased(calculatedParity, GpNvmGeometry.paritySize)) {
+            return GPNVM_PAGE_PARITY_CORRECTED;
+        }
+    }
+    errorPos = decodeAndCorrect(pageBuffer, GpNvmGeometry.pageSize, pParity);
+    if(errorPos == HAMMING_UNCORRECTABLE) {
+        return GPNVM_PAGE_UNCORRECTABLE;
+    }
+    if(errorPos == HAMMING_PARITY_CORRECTED) {
+        return GPNVM_PAGE_PARITY_CORRECTED;
+    }
+    return errorPos != 0 ? GPNVM_PAGE_CORRECTED : GPNVM_PAGE_OK;
+}
+
+/**
+ * @brief Verify range of logical pages, corrected pages are not written back
+ * @param arg gpNvmVerifyJob describing range and report
+ * @return NULL
+ */
+static void * eccVerifyWorker(void * arg) {
+    gpNvmVerifyJob * job = (gpNvmVerifyJob *)arg;
+    UInt8 pageBuffer[GPNVM_MAX_PAGE_SIZE];
+    UInt8 readParity[GPNVM_MAX_PARITY_SIZE];
+
+    for(uint32_t i = job->firstPage; i < job->endPage; i++) {
+        gpNvmPage page = gpNvm_GetLogicalPage(i);
+        if(page.bank->read(page.bank->ctx, page.pageStart, pageBuffer, GpNvmGeometry.pageSize) != GPNVM_OK ||
+            page.bank->read(page.bank->ctx, eccGetPageParityAddr(&page), readParity, GpNvmGeometry.paritySize) != GPNVM_OK) {
+            job->pReport[i] = GPNVM_PAGE_READ_ERR;
+        }
+        else {
+            job->pReport[i] = eccVerifyPage(&page, pageBuffer, readParity);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Write back pages reported as corrected, only parity is written for pages with error
+ *        in parity bits. Pages of every bank are visited in order, so parity of consecutive
+ *        pages sharing ECC page is programmed at once
+ * @param pReport health of every logical page
  * @return gpNvm_Result result of operation
  */
-gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue) {
+static gpNvm_Result eccWriteBackCorrected(const gpNvm_PageHealth * pReport) {
     gpNvm_Result res = GPNVM_OK;
+    uint32_t pageCount = GpNvmGeometry.dataPages * GpNvmBankCount;
+    UInt8 pageBuffer[GPNVM_MAX_PAGE_SIZE];
+    UInt8 readParity[GPNVM_MAX_PARITY_SIZE];
+    // ECC page holding parity being updated
+    UInt8 eccBuffer[GPNVM_MAX_PAGE_SIZE];
+    gpNvmPage eccPage;
 
-    if((UInt8)attrId > GPNVM_BLOCKS) {
-        res = GPNVM_INCORRECT_ID;
-    }
-    if(pLength == NULL || pValue == NULL) {
-        res = GPNVM_PARAM_ERR;
+    for(UInt8 bank = 0; res == GPNVM_OK && bank < GpNvmBankCount; bank++) {
+        eccPage.bank = NULL;
+        for(uint32_t i = bank; res == GPNVM_OK && i < pageCount; i += GpNvmBankCount) {
+            if(pReport[i] != GPNVM_PAGE_CORRECTED && pReport[i] != GPNVM_PAGE_PARITY_CORRECTED) {
+                continue;
+            }
+            gpNvmPage page = gpNvm_GetLogicalPage(i);
+            UInt8 * parityAddr = eccGetPageParityAddr(&page);
+            UInt8 * parityPageStart = page.bank->flashStart +
+                        ((parityAddr - page.bank->flashStart) / GpNvmGeometry.pageSize) * GpNvmGeometry.pageSize;
+
+            // Correct page again, only its position was kept by worker
+            res = page.bank->read(page.bank->ctx, page.pageStart, pageBuffer, GpNvmGeometry.pageSize);
+            if(res == GPNVM_OK) {
+                res = page.bank->read(page.bank->ctx, parityAddr, readParity, GpNvmGeometry.paritySize);
+            }
+            gpNvm_PageHealth health = GPNVM_PAGE_READ_ERR;
+            if(res == GPNVM_OK) {
+                health = eccVerifyPage(&page, pageBuffer, readParity);
+            }
+            if(health == GPNVM_PAGE_CORRECTED || health == GPNVM_PAGE_PARITY_CORRECTED) {
+                if(eccPage.bank != NULL && eccPage.pageStart != parityPageStart) {
+                    // Parity moves on to next ECC page
+                    res = gpNvm_ProgramPage(&eccPage, eccBuffer);
+                    eccPage.bank = NULL;
+                }
+                if(res == GPNVM_OK && eccPage.bank == NULL) {
+                    eccPage.bank = page.bank;
+                    eccPage.pageStart = parityPageStart;
+                    res = page.bank->read(page.bank->ctx, parityPageStart, eccBuffer, GpNvmGeometry.pageSize);
+                }
+                if(res == GPNVM_OK) {
+                    calculateParityBits(pageBuffer, GpNvmGeometry.pageSize, &eccBuffer[parityAddr - parityPageStart]);
+                }
+                if(res == GPNVM_OK && health == GPNVM_PAGE_CORRECTED) {
+                    res = gpNvm_ProgramPage(&page, pageBuffer);
+                    if(res != GPNVM_OK) {
+                        // Pending parity is matched to contents left in page and programmed
+                        if(page.bank->read(page.bank->ctx, page.pageStart, pageBuffer, GpNvmGeometry.pageSize) == GPNVM_OK) {
+                            calculateParityBits(pageBuffer, GpNvmGeometry.pageSize, &eccBuffer[parityAddr - parityPageStart]);
+                        }
+                        (void)gpNvm_ProgramPage(&eccPage, eccBuffer);
+                        eccPage.bank = NULL;
+                    }
+                }
+            }
+        }
+        if(res == GPNVM_OK && eccPage.bank != NULL) {
+            res = gpNvm_ProgramPage(&eccPage, eccBuffer);
+        }
     }
-    if(res == GPNVM_OK) {
+    return res;
+}
+#endif /* ifdef GPNVM_USE_ECC */
+
+/**
+ * @brief Read whole page into buffer, with ECC enabled content is verified and fixed
+ * @param page page to be read
+ * @param pageBuffer Buffer of page size to copy read data
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result gpNvm_ReadPage(const gpNvmPage * page, UInt8 * pageBuffer) {
+    gpNvm_Result res = page->bank->read(page->bank->ctx, page->pageStart, pageBuffer, GpNvmGeometry.pageSize);
 #ifdef GPNVM_USE_ECC
-        // Check memory ECC before write and fix errors
-        eccUpdate(attrId, ECC_SCAN_AND_FIX);
+    if(res == GPNVM_OK) {
+        res = eccScanAndFix(page, pageBuffer);
+    }
 #endif /* ifdef GPNVM_USE_ECC */
-        res = flashReadData(GpNvmBlocks[attrId].startAddr, pValue, GpNvmBlocks[attrId].length);
-        if(res == GPNVM_OK) {
-            // Return read length
-            *pLength = GpNvmBlocks[attrId].length;
+    return res;
+}
+
+/**
+ * @brief Checks if chunk of page buffer holds erased memory only
+ * @param chunk start of chunk
+ * @return 1 if every byte of chunk is 0xFF
+ */
+static UInt8 gpNvm_IsChunkErased(const UInt8 * chunk) {
+    for(uint16_t i = 0; i < GPNVM_PROGRAM_CHUNK; i++) {
+        if(chunk[i] != 0xFF) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Single attempt of erasing page and programming it with buffer contents.
+ *        Chunks left erased are skipped, consecutive chunks are programmed at once
+ * @param page page to be programmed
+ * @param pageBuffer new page contents
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result gpNvm_ProgramPageOnce(const gpNvmPage * page, UInt8 * pageBuffer) {
+    gpNvm_Result res = GPNVM_OK;
+    uint32_t runStart = 0;
+    if(page->bank->erase(page->bank->ctx, page->pageStart) != GPNVM_OK) {
+        res = GPNVM_PAGE_NOT_ERASED;
+    }
+    for(uint32_t pos = 0; res == GPNVM_OK && pos <= GpNvmGeometry.pageSize; pos += GPNVM_PROGRAM_CHUNK) {
+        if(pos == GpNvmGeometry.pageSize || gpNvm_IsChunkErased(&pageBuffer[pos])) {
+            // End of run of chunks to be programmed
+            if(pos > runStart) {
+                res = page->bank->program(page->bank->ctx, page->pageStart + runStart,
+                                            &pageBuffer[runStart], pos - runStart);
+            }
+            runStart = pos + GPNVM_PROGRAM_CHUNK;
         }
     }
     return res;
 }
 
 /**
- * @brief Program data in specified address in flash memory
+ * @brief Erase page and program it with buffer contents. Does not wait for completion.
+ *        Failed attempt is repeated from erase, so transient failure does not leave
+ *        page erased
+ * @param page page to be programmed
+ * @param pageBuffer new page contents
+ * @return gpNvm_Result result of last attempt
+ */
+static gpNvm_Result gpNvm_ProgramPage(const gpNvmPage * page, UInt8 * pageBuffer) {
+    gpNvm_Result res = GPNVM_PAGE_NOT_ERASED;
+    for(UInt8 attempt = 0; res != GPNVM_OK && attempt < GPNVM_PROGRAM_ATTEMPTS; attempt++) {
+        res = gpNvm_ProgramPageOnce(page, pageBuffer);
+    }
+    return res;
+}
+
+/**
+ * @brief Prepare contents of <attrId> block for new value. Compressed block is filled
+ *        with header and encoded value, rest of block is left erased
+ * @param length Length of value
+ * @param pValue Value to be stored
+ * @param pBlock Block contents, raw block is filled with length bytes only
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result gpNvm_EncodeBlock(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue, UInt8 * pBlock) {
+    UInt8 compression = GpNvmBlocks[attrId].compression;
+    UInt8 blockLength = GpNvmBlocks[attrId].length;
+    UInt8 * pEncoded = &pBlock[GPNVM_COMPRESSION_HEADER_SIZE];
+    // Encoded value must be smaller than raw one to pay off
+    uint16_t capacity = length - 1;
+    uint16_t encodedLength = 0;
+
+    if(compression == GPNVM_COMPRESSION_NONE) {
+        memcpy(pBlock, pValue, length);
+        return GPNVM_OK;
+    }
+    if(blockLength <= GPNVM_COMPRESSION_HEADER_SIZE) {
+        return GPNVM_PARAM_ERR;
+    }
+    if(capacity > blockLength - GPNVM_COMPRESSION_HEADER_SIZE) {
+        capacity = blockLength - GPNVM_COMPRESSION_HEADER_SIZE;
+    }
+    memset(pBlock, 0xFF, blockLength);
+
+    // Codecs run in scratch buffer, output of failed attempt must not reach the block
+    UInt8 scratch[GPNVM_MAX_VALUE_LENGTH];
+    if(compression == GPNVM_COMPRESSION_RLE || compression == GPNVM_COMPRESSION_AUTO) {
+        uint16_t rleLength = compressRle(pValue, length, scratch, capacity);
+        if(rleLength != 0) {
+            pBlock[0] = GPNVM_COMPRESSION_RLE;
+            memcpy(pEncoded, scratch, rleLength);
+            encodedLength = rleLength;
+            // Following codec has to beat this result
+            capacity = encodedLength - 1;
+        }
+    }
+    if(compression == GPNVM_COMPRESSION_LZ || compression == GPNVM_COMPRESSION_AUTO) {
+        uint16_t lzLength = compressLz(pValue, length, scratch, capacity);
+        if(lzLength != 0) {
+            pBlock[0] = GPNVM_COMPRESSION_LZ;
+            memcpy(pEncoded, scratch, lzLength);
+            // Clear rest of RLE result
+            memset(&pEncoded[lzLength], 0xFF, encodedLength > lzLength ? encodedLength - lzLength : 0);
+            encodedLength = lzLength;
+        }
+    }
+    if(encodedLength == 0) {
+        // Compression does not pay off, store raw value
+        if(length > blockLength - GPNVM_COMPRESSION_HEADER_SIZE) {
+            return GPNVM_PARAM_ERR;
+        }
+        pBlock[0] = GPNVM_COMPRESSION_NONE;
+        memcpy(pEncoded, pValue, length);
+        encodedLength = length;
+    }
+    pBlock[1] = (UInt8)encodedLength;
+    return GPNVM_OK;
+}
+
+/**
+ * @brief Gets longest value <attrId> block can hold, i.e. read buffer size needed
+ * @return Block length, or configured maximal length of compressed block
+ */
+static UInt8 gpNvm_GetMaxValueLength(gpNvm_AttrId attrId) {
+    if(GpNvmBlocks[attrId].compression == GPNVM_COMPRESSION_NONE || GpNvmBlocks[attrId].maxLength == 0) {
+        return GpNvmBlocks[attrId].length;
+    }
+    return GpNvmBlocks[attrId].maxLength;
+}
+
+/**
+ * @brief Extract value from contents of <attrId> block
+ * @param pBlock Block contents
+ * @param pLength Length of value
+ * @param pValue Buffer to copy value, holds gpNvm_GetMaxValueLength() bytes
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result gpNvm_DecodeBlock(gpNvm_AttrId attrId, UInt8 * pBlock, UInt8* pLength, UInt8* pValue) {
+    UInt8 blockLength = GpNvmBlocks[attrId].length;
+    UInt8 * pEncoded = &pBlock[GPNVM_COMPRESSION_HEADER_SIZE];
+    uint16_t encodedLength = pBlock[1];
+    uint16_t decodedLength = 0;
+    // Decoded value never exceeds caller buffer, even for corrupted block
+    uint16_t capacity = gpNvm_GetMaxValueLength(attrId);
+
+    if(GpNvmBlocks[attrId].compression == GPNVM_COMPRESSION_NONE) {
+        memcpy(pValue, pBlock, blockLength);
+        *pLength = blockLength;
+        return GPNVM_OK;
+    }
+    if(pBlock[0] == 0xFF) {
+        // Block was never written
+        *pLength = 0;
+        return GPNVM_OK;
+    }
+    if(encodedLength > blockLength - GPNVM_COMPRESSION_HEADER_SIZE) {
+        return GPNVM_COMPRESSION_ERR;
+    }
+    switch(pBlock[0]) {
+        case GPNVM_COMPRESSION_NONE:
+            if(encodedLength <= capacity) {
+                memcpy(pValue, pEncoded, encodedLength);
+                decodedLength = encodedLength;
+            }
+            break;
+        case GPNVM_COMPRESSION_RLE:
+            decodedLength = decompressRle(pEncoded, encodedLength, pValue, capacity);
+            break;
+        case GPNVM_COMPRESSION_LZ:
+            decodedLength = decompressLz(pEncoded, encodedLength, pValue, capacity);
+            break;
+        default:
+            break;
+    }
+    if(decodedLength == 0) {
+        return GPNVM_COMPRESSION_ERR;
+    }
+    *pLength = (UInt8)decodedLength;
+    return GPNVM_OK;
+}
+
+#ifdef GPNVM_USE_ECC
+/**
+ * @brief Program data in specified address in flash memory bank
+ * @param bank bank to be programmed
+ * @param addr Physical address within bank
  * @param pLength Length of data to be programmed
  * @param pValue Data to be programmed
  * @return gpNvm_Result result of operation
  */
-static gpNvm_Result gpNvm_WriteFlash(UInt8 * addr, uint16_t length, UInt8* pValue) {
+static gpNvm_Result gpNvm_WriteFlash(const gpNvm_FlashDriver * bank, UInt8 * addr, uint16_t length, UInt8* pValue) {
     // Buffer for page backup (page must be erased before write)
-    UInt8 gpNvmBuffer[GPNVM_PAGE_SIZE] = {0};
+    UInt8 gpNvmBuffer[GPNVM_MAX_PAGE_SIZE];
+    uint16_t pageSize = GpNvmGeometry.pageSize;
+    gpNvmPage page;
     UInt8 res = GPNVM_OK;
 
-    UInt8 * pageStart = (UInt8 *)((int)addr / GPNVM_PAGE_SIZE * GPNVM_PAGE_SIZE);
+    page.bank = bank;
+    page.pageStart = bank->flashStart + ((addr - bank->flashStart) / pageSize) * pageSize;
     // Load page into buffer
-    res = flashReadData(pageStart, gpNvmBuffer, GPNVM_PAGE_SIZE);
+    res = bank->read(bank->ctx, page.pageStart, gpNvmBuffer, pageSize);
     if(res == GPNVM_OK) {
-        if(flashErasePage(addr) != GPNVM_OK) {
-            res = GPNVM_PAGE_NOT_ERASED;
-        }
-        // Calculate new data offset from page start
-        int newDataPos = (int)((int)addr - (int)pageStart);
         // Copy new data to page backup
-        memcpy(&gpNvmBuffer[newDataPos], pValue, length);
+        memcpy(&gpNvmBuffer[addr - page.pageStart], pValue, length);
         // Rewrite page with new data
-        res = flashWrite(pageStart, gpNvmBuffer, GPNVM_PAGE_SIZE);
+        res = gpNvm_ProgramPage(&page, gpNvmBuffer);
     }
     return res;
 }
+#endif /* ifdef GPNVM_USE_ECC */
+
+/**
+ * @brief Gets offset of <attrId> block within its page
+ * @param attrId data of interest
+ * @return Offset from page start
+ */
+static uint16_t gpNvm_GetBlockOffset(gpNvm_AttrId attrId) {
+    return (uint16_t)(((uintptr_t)GpNvmBlocks[attrId].startAddr - GPNVM_FLASH_START) % GpNvmGeometry.pageSize);
+}
 
 /**
- * @brief Program <attrId> memory block
- * @param pLength Length of data to be programmed
- * @param pValue Data to be programmed
+ * @brief Gets length of block contents programmed for value prepared by gpNvm_EncodeBlock()
+ * @param length Length of value
+ * @return Number of bytes from block start to be programmed
+ */
+static UInt8 gpNvm_GetImageLength(gpNvm_AttrId attrId, UInt8 length) {
+    if(GpNvmBlocks[attrId].compression == GPNVM_COMPRESSION_NONE) {
+        return length;
+    }
+    return GpNvmBlocks[attrId].length;
+}
+
+#ifdef GPNVM_USE_WRITE_CACHE
+/**
+ * @brief Gets logical page of <attrId> block
+ * @return Page number in logical address space
+ */
+static uintptr_t cacheGetLogicalPage(gpNvm_AttrId attrId) {
+    return ((uintptr_t)GpNvmBlocks[attrId].startAddr - GPNVM_FLASH_START) / GpNvmGeometry.pageSize;
+}
+
+/**
+ * @brief Gets cache entry holding <attrId> block
+ * @return Dirty entry of block, NULL if block is not cached
+ */
+static gpNvmCacheEntry * cacheFind(gpNvm_AttrId attrId) {
+    for(uint16_t i = 0; i < GPNVM_CACHE_ENTRIES; i++) {
+        if(GpNvmCache[i].dirty && GpNvmCache[i].attrId == attrId) {
+            return &GpNvmCache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Copy contents of dirty cache entries residing in page into page buffer
+ * @param attrId any block of the page
+ * @param pageBuffer page contents
+ */
+static void cacheOverlayPage(gpNvm_AttrId attrId, UInt8 * pageBuffer) {
+    uintptr_t pageNo = cacheGetLogicalPage(attrId);
+    for(uint16_t i = 0; i < GPNVM_CACHE_ENTRIES; i++) {
+        gpNvmCacheEntry * entry = &GpNvmCache[i];
+        if(entry->dirty && cacheGetLogicalPage(entry->attrId) == pageNo) {
+            memcpy(&pageBuffer[gpNvm_GetBlockOffset(entry->attrId)], entry->image, entry->length);
+        }
+    }
+}
+
+/**
+ * @brief Mark cache entries residing in page as clean, once page program was started
+ * @param attrId any block of the page
+ */
+static void cacheMarkPageClean(gpNvm_AttrId attrId) {
+    uintptr_t pageNo = cacheGetLogicalPage(attrId);
+    for(uint16_t i = 0; i < GPNVM_CACHE_ENTRIES; i++) {
+        gpNvmCacheEntry * entry = &GpNvmCache[i];
+        if(entry->dirty && cacheGetLogicalPage(entry->attrId) == pageNo) {
+            entry->dirty = 0;
+            GpNvmCacheDirtyCount--;
+        }
+    }
+}
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+
+/**
+ * @brief Program contents of <attrId> block. Dirty cached blocks of the same page
+ *        are programmed along
+ * @param pImage Block contents
+ * @param imageLength Number of bytes from block start to be programmed
  * @return gpNvm_Result result of operation
  */
-gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue) {
+static gpNvm_Result gpNvm_WriteBlock(gpNvm_AttrId attrId, UInt8 * pImage, UInt8 imageLength) {
+    // Buffer holding page data
+    UInt8 gpNvmBuffer[GPNVM_MAX_PAGE_SIZE];
+    gpNvmPage page = gpNvm_GetPage(attrId);
+
+    // Page backup, ECC errors are detected and fixed before modifying memory
+    gpNvm_Result res = gpNvm_ReadPage(&page, gpNvmBuffer);
+    if(res == GPNVM_OK) {
+#ifdef GPNVM_USE_WRITE_CACHE
+        cacheOverlayPage(attrId, gpNvmBuffer);
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+        memcpy(&gpNvmBuffer[gpNvm_GetBlockOffset(attrId)], pImage, imageLength);
+#ifdef GPNVM_USE_ECC
+        // Update parity due to new data in the page
+        res = eccUpdateParity(&page, gpNvmBuffer);
+#endif /* ifdef GPNVM_USE_ECC */
+    }
+    if(res == GPNVM_OK) {
+        res = gpNvm_ProgramPage(&page, gpNvmBuffer);
+#ifdef GPNVM_USE_ECC
+        if(res != GPNVM_OK) {
+            eccRestoreParity(&page, gpNvmBuffer);
+        }
+#endif /* ifdef GPNVM_USE_ECC */
+    }
+#ifdef GPNVM_USE_WRITE_CACHE
+    if(res == GPNVM_OK) {
+        // Cached values are dropped only once their page is programmed
+        cacheMarkPageClean(attrId);
+    }
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+    return res;
+}
+
+#ifdef GPNVM_USE_WRITE_CACHE
+/**
+ * @brief Program cached block together with dirty blocks of its page
+ * @param entry dirty cache entry
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result cacheFlushEntry(gpNvmCacheEntry * entry) {
+    // Dirty flag is cleared once page is programmed, entry is kept on failure
+    return gpNvm_WriteBlock(entry->attrId, entry->image, entry->length);
+}
+
+/**
+ * @brief Program dirty blocks held longer than hold time, or every dirty block if all is set
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result cacheFlushExpired(UInt8 all) {
     gpNvm_Result res = GPNVM_OK;
+    for(uint16_t i = 0; res == GPNVM_OK && i < GPNVM_CACHE_ENTRIES; i++) {
+        gpNvmCacheEntry * entry = &GpNvmCache[i];
+        if(entry->dirty && (all || GpNvmCacheTime - entry->since >= GpNvmCacheHoldTime)) {
+            res = cacheFlushEntry(entry);
+        }
+    }
+    return res;
+}
 
-    if((UInt8)attrId > GPNVM_BLOCKS) {
-        res = GPNVM_INCORRECT_ID;
+/**
+ * @brief Program block being dirty for longest time together with dirty blocks of its page
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result cacheFlushOldest(void) {
+    gpNvm_Result res = GPNVM_OK;
+    gpNvmCacheEntry * oldest = NULL;
+    for(uint16_t i = 0; i < GPNVM_CACHE_ENTRIES; i++) {
+        if(GpNvmCache[i].dirty &&
+            (oldest == NULL || GpNvmCacheTime - GpNvmCache[i].since > GpNvmCacheTime - oldest->since)) {
+            oldest = &GpNvmCache[i];
+        }
     }
-    if(pValue == NULL || length == 0 || length > GpNvmBlocks[attrId].length) {
-        res = GPNVM_PARAM_ERR;
+    if(oldest != NULL) {
+        res = cacheFlushEntry(oldest);
+    }
+    return res;
+}
+
+/**
+ * @brief Keep contents of <attrId> block in cache. When dirty limit is reached,
+ *        block being dirty for longest time is programmed first
+ * @param pImage Block contents
+ * @param imageLength Number of bytes from block start to be programmed
+ * @return gpNvm_Result result of operation
+ */
+static gpNvm_Result cacheStore(gpNvm_AttrId attrId, UInt8 * pImage, UInt8 imageLength) {
+    gpNvm_Result res = GPNVM_OK;
+    gpNvmCacheEntry * entry = cacheFind(attrId);
+
+    if(entry == NULL && GpNvmCacheDirtyCount >= GpNvmCacheDirtyLimit) {
+        res = cacheFlushOldest();
+    }
+    if(res == GPNVM_OK && entry == NULL) {
+        // Dirty limit does not exceed pool size, free entry is left
+        for(uint16_t i = 0; entry == NULL && i < GPNVM_CACHE_ENTRIES; i++) {
+            if(!GpNvmCache[i].dirty) {
+                entry = &GpNvmCache[i];
+            }
+        }
+        if(entry == NULL) {
+            res = GPNVM_PARAM_ERR;
+        }
+    }
+    if(res == GPNVM_OK) {
+        memcpy(entry->image, pImage, imageLength);
+        if(entry->dirty) {
+            // Tail of longer value held earlier is still to be programmed
+            if(imageLength > entry->length) {
+                entry->length = imageLength;
+            }
+        } else {
+            entry->length = imageLength;
+            // Hold time counts from first absorbed write
+            entry->attrId = attrId;
+            entry->dirty = 1;
+            entry->since = GpNvmCacheTime;
+            GpNvmCacheDirtyCount++;
+        }
+    }
+    return res;
+}
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+
+/**
+ * @brief Initialize component with flash banks. Geometry is derived from drivers
+ *        and memory map is verified against it
+ * @param banks Array of flash drivers, logical pages are interleaved over them
+ * @param bankCount Number of drivers in array
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_Init(const gpNvm_FlashDriver * banks, UInt8 bankCount) {
+    gpNvmGeometry geometry;
+    uint32_t bankPages = 0;
+    uint32_t reservedPages = 0;
+
+    if(banks == NULL || bankCount == 0) {
+        return GPNVM_PARAM_ERR;
+    }
+    geometry.pageSize = banks[0].pageSize;
+    bankPages = banks[0].pageCount;
+    for(UInt8 i = 0; i < bankCount; i++) {
+        if(banks[i].pageSize != geometry.pageSize) {
+            return GPNVM_PARAM_ERR;
+        }
+        if(banks[i].pageCount < bankPages) {
+            bankPages = banks[i].pageCount;
+        }
+    }
+    if(geometry.pageSize == 0 || geometry.pageSize > GPNVM_MAX_PAGE_SIZE ||
+        geometry.pageSize % GPNVM_PROGRAM_CHUNK != 0) {
+        return GPNVM_PARAM_ERR;
     }
 #ifdef GPNVM_USE_ECC
-    // Detect and fix ECC errors before accessing memory
-    eccUpdate(attrId, ECC_SCAN_AND_FIX);
+    geometry.paritySize = getParitySize(geometry.pageSize);
+    geometry.parityPerPage = geometry.pageSize / geometry.paritySize;
+    reservedPages = GPNVM_ECC_PAGES;
+    if(reservedPages == 0) {
+        // Smallest region holding parity of all remaining pages
+        reservedPages = (bankPages + geometry.parityPerPage) / (geometry.parityPerPage + 1);
+    }
+    if(reservedPages >= bankPages ||
+        (uint64_t)(bankPages - reservedPages) > (uint64_t)reservedPages * geometry.parityPerPage) {
+        return GPNVM_OUT_OF_BOUNDS;
+    }
+#endif /* ifdef GPNVM_USE_ECC */
+    geometry.dataPages = bankPages - reservedPages;
+    geometry.firstDataPage = 0;
+#ifdef GPNVM_USE_ECC
+    if(GPNVM_ECC_PLACEMENT == GPNVM_ECC_AT_START) {
+        geometry.eccOffset = 0;
+        geometry.firstDataPage = reservedPages;
+    }
+    else {
+        geometry.eccOffset = geometry.dataPages * geometry.pageSize;
+    }
 #endif /* ifdef GPNVM_USE_ECC */
 
-    res = gpNvm_WriteFlash(GpNvmBlocks[attrId].startAddr, length, pValue);
+    // Every block must fit in single page of logical address space
+    for(gpNvm_AttrId i = 0; i < GPNVM_BLOCKS; i++) {
+        uintptr_t offset = (uintptr_t)GpNvmBlocks[i].startAddr - GPNVM_FLASH_START;
+        if((uintptr_t)GpNvmBlocks[i].startAddr < GPNVM_FLASH_START ||
+            offset / geometry.pageSize >= (uint64_t)geometry.dataPages * bankCount ||
+            offset % geometry.pageSize + GpNvmBlocks[i].length > geometry.pageSize) {
+            return GPNVM_OUT_OF_BOUNDS;
+        }
+    }
+
+    GpNvmGeometry = geometry;
+    GpNvmBanks = banks;
+    GpNvmBankCount = bankCount;
+#ifdef GPNVM_USE_WRITE_CACHE
+    // Write cache is disabled until configured
+    memset(GpNvmCache, 0, sizeof(GpNvmCache));
+    GpNvmCacheDirtyCount = 0;
+    GpNvmCacheDirtyLimit = 0;
+    GpNvmCacheHoldTime = 0;
+    GpNvmCacheTime = 0;
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+    return GPNVM_OK;
+}
+
+/**
+ * @brief Wait for completion of all outstanding operations in all banks
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_Sync(void) {
+    gpNvm_Result res = GPNVM_OK;
+
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+    for(UInt8 i = 0; res == GPNVM_OK && i < GpNvmBankCount; i++) {
+        res = GpNvmBanks[i].sync(GpNvmBanks[i].ctx);
+    }
+    return res;
+}
+
+/**
+ * @brief Program all blocks held in write cache and wait until they are stored
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_Flush(void) {
+    gpNvm_Result res = GPNVM_OK;
+
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+#ifdef GPNVM_USE_WRITE_CACHE
+    if(res == GPNVM_OK) {
+        res = cacheFlushExpired(1);
+    }
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+    if(res == GPNVM_OK) {
+        res = gpNvm_Sync();
+    }
+    return res;
+}
+
+/**
+ * @brief Configure write cache absorbing repeated writes of attributes. Value is programmed
+ *        once held for holdTime or when more than dirtyLimit attributes would be dirty.
+ *        When limit is lowered, oldest values are programmed until it is met
+ * @param holdTime Maximal time value is held in cache, unit of time passed to gpNvm_Process()
+ * @param dirtyLimit Maximal number of dirty attributes up to GPNVM_CACHE_ENTRIES, 0 disables cache
+ * @return gpNvm_Result result of operation, GPNVM_PARAM_ERR if cache is not compiled in
+ */
+gpNvm_Result gpNvm_ConfigureWriteCache(uint32_t holdTime, uint16_t dirtyLimit) {
+    gpNvm_Result res = GPNVM_OK;
+
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+#ifndef GPNVM_USE_WRITE_CACHE
+    if(dirtyLimit != 0) {
+        res = GPNVM_PARAM_ERR;
+    }
+#else
+    if(dirtyLimit > GPNVM_CACHE_ENTRIES) {
+        res = GPNVM_PARAM_ERR;
+    }
+    while(res == GPNVM_OK && GpNvmCacheDirtyCount > dirtyLimit) {
+        // Oldest cached values are programmed until new limit is met (all if disabled)
+        res = cacheFlushOldest();
+    }
+    if(res == GPNVM_OK) {
+        GpNvmCacheHoldTime = holdTime;
+        GpNvmCacheDirtyLimit = dirtyLimit;
+    }
+#endif /* ifndef GPNVM_USE_WRITE_CACHE */
+    return res;
+}
 
+/**
+ * @brief Periodic processing, programs values held in write cache for hold time
+ * @param now Current time, writes are timestamped with last time passed
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_Process(uint32_t now) {
+    gpNvm_Result res = GPNVM_OK;
+
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+#ifdef GPNVM_USE_WRITE_CACHE
+    if(res == GPNVM_OK) {
+        GpNvmCacheTime = now;
+        res = cacheFlushExpired(0);
+    }
+#else
+    (void)now;
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+    return res;
+}
+
+/**
+ * @brief Gets number of logical pages, i.e. length of gpNvm_VerifyAll() report
+ * @return Number of pages, 0 if not initialized
+ */
+uint32_t gpNvm_GetPageCount(void) {
+    if(GpNvmBanks == NULL) {
+        return 0;
+    }
+    return GpNvmGeometry.dataPages * GpNvmBankCount;
+}
+
+/**
+ * @brief Verify integrity of every page and fix single bit errors. Pages are split over
+ *        threads workers, corrected pages are written back once all pages are verified
+ * @param threads Number of workers, caller thread is one of them
+ * @param pReport Health of every logical page (GPNVM_PAGE_xxx)
+ * @param reportLength Number of entries in report, at least gpNvm_GetPageCount()
+ * @return gpNvm_Result result of operation, GPNVM_PARAM_ERR if ECC is not compiled in
+ */
+gpNvm_Result gpNvm_VerifyAll(UInt8 threads, gpNvm_PageHealth * pReport, uint32_t reportLength) {
+    gpNvm_Result res = GPNVM_OK;
+    uint32_t pageCount = gpNvm_GetPageCount();
+
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+    else if(pReport == NULL || reportLength < pageCount) {
+        res = GPNVM_PARAM_ERR;
+    }
+#ifndef GPNVM_USE_ECC
+    if(res == GPNVM_OK) {
+        res = GPNVM_PARAM_ERR;
+    }
+    (void)threads;
+#else
+    if(res == GPNVM_OK) {
+        // Workers read idle banks only
+        res = gpNvm_Sync();
+    }
+    if(res == GPNVM_OK) {
+        gpNvmVerifyJob jobs[GPNVM_MAX_VERIFY_THREADS];
+        if(threads == 0) {
+            threads = 1;
+        }
+        if(threads > GPNVM_MAX_VERIFY_THREADS) {
+            threads = GPNVM_MAX_VERIFY_THREADS;
+        }
+        for(UInt8 i = 0; i < threads; i++) {
+            jobs[i].firstPage = (uint32_t)((uint64_t)pageCount * i / threads);
+            jobs[i].endPage = (uint32_t)((uint64_t)pageCount * (i + 1) / threads);
+            jobs[i].pReport = pReport;
+        }
+#ifdef GPNVM_USE_THREADS
+        pthread_t workers[GPNVM_MAX_VERIFY_THREADS];
+        UInt8 started[GPNVM_MAX_VERIFY_THREADS] = {0};
+        for(UInt8 i = 1; i < threads; i++) {
+            started[i] = pthread_create(&workers[i], NULL, eccVerifyWorker, &jobs[i]) == 0;
+        }
+        eccVerifyWorker(&jobs[0]);
+        for(UInt8 i = 1; i < threads; i++) {
+            if(started[i]) {
+                pthread_join(workers[i], NULL);
+            }
+            else {
+                // Worker could not be started, its range is verified here
+                eccVerifyWorker(&jobs[i]);
+            }
+        }
+#else
+        for(UInt8 i = 0; i < threads; i++) {
+            eccVerifyWorker(&jobs[i]);
+        }
+#endif /* ifdef GPNVM_USE_THREADS */
+        res = eccWriteBackCorrected(pReport);
+    }
+#endif /* ifndef GPNVM_USE_ECC */
+    return res;
+}
+
+/**
+ * @brief Erase logical page together with its parity, recovers page reported by
+ *        gpNvm_VerifyAll() as uncorrectable. Blocks of the page read back erased,
+ *        values held in write cache are programmed on next flush
+ * @param logicalPage Index of page in gpNvm_VerifyAll() report
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_ErasePage(uint32_t logicalPage) {
+    gpNvm_Result res = GPNVM_OK;
+    // Erased image of page
+    UInt8 gpNvmBuffer[GPNVM_MAX_PAGE_SIZE];
+
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+    else if(logicalPage >= gpNvm_GetPageCount()) {
+        res = GPNVM_OUT_OF_BOUNDS;
+    }
+    if(res == GPNVM_OK) {
+        gpNvmPage page = gpNvm_GetLogicalPage(logicalPage);
+        memset(gpNvmBuffer, 0xFF, GpNvmGeometry.pageSize);
+        // Data goes first, interrupted erase leaves page uncorrectable rather than trusted
+        res = gpNvm_ProgramPage(&page, gpNvmBuffer);
 #ifdef GPNVM_USE_ECC
-    // Update parity due to new data in the block
-    eccUpdate(attrId, ECC_UPDATE_PARITY);
+        if(res == GPNVM_OK) {
+            // Erased page with erased parity was never programmed
+            res = gpNvm_WriteFlash(page.bank, eccGetPageParityAddr(&page), GpNvmGeometry.paritySize, gpNvmBuffer);
+        }
 #endif /* ifdef GPNVM_USE_ECC */
+    }
+    return res;
+}
+
+/**
+ * @brief Reads <attrId> memory block
+ * @param pLength Length of read block
+ * @param pValue Buffer to copy read data, block length (maxLength of compressed block) bytes
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_GetAttribute(gpNvm_AttrId attrId, UInt8* pLength, UInt8* pValue) {
+    gpNvm_Result res = GPNVM_OK;
+    // Buffer holding page data
+    UInt8 gpNvmBuffer[GPNVM_MAX_PAGE_SIZE];
+
+    if(attrId >= GPNVM_BLOCKS) {
+        res = GPNVM_INCORRECT_ID;
+    }
+    if(pLength == NULL || pValue == NULL) {
+        res = GPNVM_PARAM_ERR;
+    }
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+    if(res == GPNVM_OK) {
+        gpNvmPage page = gpNvm_GetPage(attrId);
+        // Read page, check memory ECC and fix errors
+        res = gpNvm_ReadPage(&page, gpNvmBuffer);
+    }
+    if(res == GPNVM_OK) {
+#ifdef GPNVM_USE_WRITE_CACHE
+        // Value not programmed yet takes precedence
+        cacheOverlayPage(attrId, gpNvmBuffer);
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+        // Copy value and return its length
+        res = gpNvm_DecodeBlock(attrId, &gpNvmBuffer[gpNvm_GetBlockOffset(attrId)], pLength, pValue);
+    }
+    return res;
+}
+
+/**
+ * @brief Program <attrId> memory block. Returns once page program is started,
+ *        use gpNvm_Sync() to wait for completion. With write cache configured
+ *        value is kept in RAM, use gpNvm_Flush() to program it right away
+ * @param pLength Length of data to be programmed
+ * @param pValue Data to be programmed
+ * @return gpNvm_Result result of operation
+ */
+gpNvm_Result gpNvm_SetAttribute(gpNvm_AttrId attrId, UInt8 length, UInt8* pValue) {
+    gpNvm_Result res = GPNVM_OK;
+    // Block contents to be programmed
+    UInt8 blockImage[GPNVM_MAX_VALUE_LENGTH];
 
+    if(attrId >= GPNVM_BLOCKS) {
+        res = GPNVM_INCORRECT_ID;
+    }
+    else if(pValue == NULL || length == 0) {
+        res = GPNVM_PARAM_ERR;
+    }
+    // Compressed block may hold value longer than block itself, up to its maximal length
+    else if(length > gpNvm_GetMaxValueLength(attrId)) {
+        res = GPNVM_PARAM_ERR;
+    }
+    if(GpNvmBanks == NULL) {
+        res = GPNVM_NOT_INITIALIZED;
+    }
+    if(res == GPNVM_OK) {
+        res = gpNvm_EncodeBlock(attrId, length, pValue, blockImage);
+    }
+    if(res == GPNVM_OK) {
+#ifdef GPNVM_USE_WRITE_CACHE
+        if(GpNvmCacheDirtyLimit != 0) {
+            return cacheStore(attrId, blockImage, gpNvm_GetImageLength(attrId, length));
+        }
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+        res = gpNvm_WriteBlock(attrId, blockImage, gpNvm_GetImageLength(attrId, length));
+    }
     return res;
-}
\ No newline at end of file
+}
@@ -0,0 +1,188 @@
+/**
+ **********************************************************************************
+ * File: [gpNvmCompress.c]
+ * Author: [Maciej Sliwinski]
+ * Description: [Non-volatile memory storage component]
+ *
+ * This software is provided "as is" without any warranties.
+ **********************************************************************************
+
+    Codecs used for transparent compression of attribute payloads.
+
+    RLE: control byte 0x00-0x7F is followed by (control + 1) literal bytes,
+         control byte 0x80-0xFF is followed by single byte repeated (control - 0x80 + 3) times.
+    LZ:  LZSS with dictionary of 256 previously decoded bytes. Flag byte precedes every
+         group of 8 tokens, set bit marks match token. Literal token is a single byte,
+         match token is two bytes: (offset - 1) and (length - 3).
+ */
+
+#include <string.h>
+#include "gpNvmCompress.h"
+
+#define RLE_MIN_RUN 3
+#define RLE_MAX_RUN (0x7F + RLE_MIN_RUN)
+#define RLE_MAX_LITERALS 0x80
+
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (0xFF + LZ_MIN_MATCH)
+#define LZ_WINDOW 0x100
+
+static uint16_t rleRunLength(const UInt8 *src, uint16_t pos, uint16_t srcLength) {
+    uint16_t run = 1;
+    while (pos + run < srcLength && src[pos + run] == src[pos] && run < RLE_MAX_RUN) {
+        run++;
+    }
+    return run;
+}
+
+uint16_t compressRle(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity) {
+    uint16_t in = 0;
+    uint16_t out = 0;
+
+    while (in < srcLength) {
+        uint16_t run = rleRunLength(src, in, srcLength);
+        if (run >= RLE_MIN_RUN) {
+            if (out + 2 > dstCapacity) {
+                return 0;
+            }
+            dst[out++] = (UInt8)(0x80 + run - RLE_MIN_RUN);
+            dst[out++] = src[in];
+            in += run;
+        }
+        else {
+            // Collect literals until next run worth encoding
+            uint16_t start = in;
+            while (in < srcLength && in - start < RLE_MAX_LITERALS &&
+                    rleRunLength(src, in, srcLength) < RLE_MIN_RUN) {
+                in++;
+            }
+            uint16_t literals = in - start;
+            if (out + 1 + literals > dstCapacity) {
+                return 0;
+            }
+            dst[out++] = (UInt8)(literals - 1);
+            memcpy(&dst[out], &src[start], literals);
+            out += literals;
+        }
+    }
+    return out;
+}
+
+uint16_t decompressRle(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity) {
+    uint16_t in = 0;
+    uint16_t out = 0;
+
+    while (in < srcLength) {
+        UInt8 control = src[in++];
+        if (control < 0x80) {
+            uint16_t literals = control + 1;
+            if (in + literals > srcLength || out + literals > dstCapacity) {
+                return 0;
+            }
+            memcpy(&dst[out], &src[in], literals);
+            in += literals;
+            out += literals;
+        }
+        else {
+            uint16_t run = control - 0x80 + RLE_MIN_RUN;
+            if (in >= srcLength || out + run > dstCapacity) {
+                return 0;
+            }
+            memset(&dst[out], src[in++], run);
+            out += run;
+        }
+    }
+    return out;
+}
+
+uint16_t compressLz(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity) {
+    uint16_t in = 0;
+    uint16_t out = 0;
+    uint16_t flagPos = 0;
+    UInt8 token = 0;
+
+    while (in < srcLength) {
+        if (token % 8 == 0) {
+            // Start new group of tokens
+            if (out >= dstCapacity) {
+                return 0;
+            }
+            flagPos = out;
+            dst[out++] = 0;
+        }
+        // Greedy search for longest match in dictionary
+        uint16_t bestLength = 0;
+        uint16_t bestOffset = 0;
+        uint16_t windowStart = in > LZ_WINDOW ? in - LZ_WINDOW : 0;
+        for (uint16_t candidate = windowStart; candidate < in; candidate++) {
+            uint16_t length = 0;
+            while (in + length < srcLength && length < LZ_MAX_MATCH &&
+                    src[candidate + length] == src[in + length]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestOffset = in - candidate;
+                if (in + length == srcLength || length == LZ_MAX_MATCH) {
+                    // Cannot be improved
+                    break;
+                }
+            }
+        }
+        if (bestLength >= LZ_MIN_MATCH) {
+            if (out + 2 > dstCapacity) {
+                return 0;
+            }
+            dst[flagPos] |= (UInt8)(1 << (token % 8));
+            dst[out++] = (UInt8)(bestOffset - 1);
+            dst[out++] = (UInt8)(bestLength - LZ_MIN_MATCH);
+            in += bestLength;
+        }
+        else {
+            if (out + 1 > dstCapacity) {
+                return 0;
+            }
+            dst[out++] = src[in++];
+        }
+        token++;
+    }
+    return out;
+}
+
+uint16_t decompressLz(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity) {
+    uint16_t in = 0;
+    uint16_t out = 0;
+    UInt8 flags = 0;
+    UInt8 token = 0;
+
+    while (in < srcLength) {
+        if (token % 8 == 0) {
+            flags = src[in++];
+            if (in >= srcLength) {
+                return 0;
+            }
+        }
+        if (flags & (1 << (token % 8))) {
+            if (in + 2 > srcLength) {
+                return 0;
+            }
+            uint16_t offset = src[in++] + 1;
+            uint16_t length = src[in++] + LZ_MIN_MATCH;
+            if (offset > out || out + length > dstCapacity) {
+                return 0;
+            }
+            // Byte by byte copy, match may overlap decoded data
+            for (uint16_t i = 0; i < length; i++, out++) {
+                dst[out] = dst[out - offset];
+            }
+        }
+        else {
+            if (out >= dstCapacity) {
+                return 0;
+            }
+            dst[out++] = src[in++];
+        }
+        token++;
+    }
+    return out;
+}
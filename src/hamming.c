@@ -10,64 +10,147 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "hamming.h"
-#include "gpNvmMap.h"
 
-#define PARITY_BITS 14
-#define TOTAL_BITS (GPNVM_PAGE_SIZE * 8)
-#define DATA_BITS (GPNVM_PAGE_SIZE * 8)
-
-// Function to calculate parity bits based on the data bits
-void calculateParityBits(uint8_t *data, uint8_t *parity) {
-    for (int i = 0; i < PARITY_BITS; i++) {
-        parity[i / 8] &= ~(1 << (i % 8)); // Clear parity bit
+// Number of Hamming bits needed to locate single bit error in data of given size (bytes).
+// Data and Hamming bits share positions 1..2^bits-1, Hamming bits take powers of two
+static UInt8 getHammingBits(uint32_t dataSize) {
+    uint64_t dataBits = (uint64_t)dataSize * 8;
+    UInt8 hammingBits = 0;
+    while (hammingBits < 31 && (1ULL << hammingBits) < dataBits + hammingBits + 1) {
+        hammingBits++;
     }
+    return hammingBits;
+}
+
+// Number of parity bits of data of given size (bytes): Hamming bits followed by overall
+// parity bit, which tells single errors (correctable) from double ones (detected only)
+UInt8 getParityBits(uint32_t dataSize) {
+    return getHammingBits(dataSize) + 1;
+}
+
+// Number of bytes holding parity bits of data of given size (bytes)
+UInt8 getParitySize(uint32_t dataSize) {
+    return (getParityBits(dataSize) + 7) / 8;
+}
+
+// Syndrome of data: XOR of positions of all set bits, data bits take positions which are not
+// powers of two. Its bit i equals parity of all data bits whose position has bit i set, i.e.
+// Hamming parity bit i. Parity of number of set bits is returned in pOnes
+static uint32_t calculateSyndrome(const uint8_t *data, uint32_t dataSize, uint8_t *pOnes) {
+    uint32_t syndrome = 0;
+    uint8_t ones = 0;
+    // Position of previous data bit and next position taken by Hamming bit
+    uint32_t position = 2;
+    uint32_t nextHamming = 4;
 
-    int bitIndex, parityIndex;
-    for (parityIndex = 0; parityIndex < PARITY_BITS; parityIndex++) {
-        int parityBitPosition = 1 << parityIndex; // 2^parityIndex
-        int count = 0;  // Count of 1's for the current parity bit
-        for (bitIndex = parityBitPosition - 1; bitIndex < DATA_BITS; bitIndex += 2 * parityBitPosition) {
-            for (int j = bitIndex; j < bitIndex + parityBitPosition && j < DATA_BITS; j++) {
-                if ((data[j / 8] & (1 << (j % 8))) != 0) {
-                    count++;
+    for (uint32_t n = 0; n < dataSize; n++) {
+        uint8_t byte = data[n];
+        if (position + 8 < nextHamming) {
+            // Positions of this byte are consecutive, visit set bits only
+            for (uint32_t bitPosition = position + 1; byte != 0; byte >>= 1, bitPosition++) {
+                if (byte & 1) {
+                    syndrome ^= bitPosition;
+                    ones ^= 1;
                 }
             }
+            position += 8;
+            continue;
         }
-        // Set the current parity bit based on the count of 1's
-        if (count % 2 != 0) { // Odd parity
-            parity[parityIndex / 8] |= (1 << (parityIndex % 8));
+        for (int i = 0; i < 8; i++) {
+            position++;
+            if (position == nextHamming) {
+                position++;
+                nextHamming <<= 1;
+            }
+            if ((byte >> i) & 1) {
+                syndrome ^= position;
+                ones ^= 1;
+            }
         }
     }
+    *pOnes = ones;
+    return syndrome;
 }
 
-// Function to decode and correct errors in the data
-UInt8 decodeAndCorrect(uint8_t *data, uint8_t *parity) {
-    uint32_t error_pos = 0;
+// Parity of bits of value
+static uint8_t bitParity(uint32_t value) {
+    uint8_t result = 0;
+    for (; value != 0; value &= value - 1) {
+        result ^= 1;
+    }
+    return result;
+}
 
-    for (uint32_t i = 0; i < PARITY_BITS; i++) {
-        uint32_t parityBitPosition = 1 << i;
-        uint32_t count = 0;
-        for (uint32_t j = parityBitPosition - 1; j < DATA_BITS; j += 2 * parityBitPosition) {
-            for (uint32_t k = j; k < j + parityBitPosition && k < DATA_BITS; k++) {
-                if ((data[k / 8] & (1 << (k % 8))) != 0) {
-                    count++;
-                }
-            }
-        }
-        if ((count % 2) != ((parity[i / 8] >> (i % 8)) & 1)) {
-            error_pos += parityBitPosition;
-        }
+static uint8_t getBit(const uint8_t *bits, uint32_t i) {
+    return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+static void setBit(uint8_t *bits, uint32_t i, uint8_t value) {
+    bits[i / 8] &= ~(1 << (i % 8));
+    bits[i / 8] |= (value & 1) << (i % 8);
+}
+
+// Function to calculate parity bits based on the data bits
+void calculateParityBits(uint8_t *data, uint32_t dataSize, uint8_t *parity) {
+    const uint32_t HAMMING_BITS = getHammingBits(dataSize);
+    uint8_t ones = 0;
+    uint32_t syndrome = calculateSyndrome(data, dataSize, &ones);
+
+    for (uint32_t i = 0; i < HAMMING_BITS; i++) {
+        setBit(parity, i, (uint8_t)(syndrome >> i));
     }
+    // Even parity of whole codeword
+    setBit(parity, HAMMING_BITS, ones ^ bitParity(syndrome));
+}
+
+// Function to decode and correct errors in the data. Single error in parity bits is fixed
+// in parity only, HAMMING_PARITY_CORRECTED is then returned
+uint32_t decodeAndCorrect(uint8_t *data, uint32_t dataSize, uint8_t *parity) {
+    const uint32_t DATA_BITS = dataSize * 8;
+    const uint32_t HAMMING_BITS = getHammingBits(dataSize);
+    uint8_t ones = 0;
+    uint32_t syndrome = calculateSyndrome(data, dataSize, &ones);
+    uint32_t stored = 0;
 
-    if (error_pos != 0 && error_pos <= DATA_BITS) {
+    for (uint32_t i = 0; i < HAMMING_BITS; i++) {
+        stored |= (uint32_t)getBit(parity, i) << i;
+    }
+    syndrome ^= stored;
+    // Odd number of flipped bits in whole codeword
+    uint8_t odd = ones ^ bitParity(stored) ^ getBit(parity, HAMMING_BITS);
+
+    if (syndrome == 0 && !odd) {
+        return 0; // No error
+    }
+    if (!odd) {
+        return HAMMING_UNCORRECTABLE; // Double error
+    }
+    if (syndrome == 0) {
+        // Overall parity bit flipped
+        setBit(parity, HAMMING_BITS, !getBit(parity, HAMMING_BITS));
+        return HAMMING_PARITY_CORRECTED;
+    }
+    uint32_t hammingBit = 0;
+    while ((syndrome >> (hammingBit + 1)) != 0) {
+        hammingBit++;
+    }
+    if (syndrome == (1UL << hammingBit)) {
+        // Hamming bit flipped
+        setBit(parity, hammingBit, !getBit(parity, hammingBit));
+        return HAMMING_PARITY_CORRECTED;
+    }
+    // Data bit index is position less preceding Hamming bit positions
+    uint32_t error_pos = syndrome - (hammingBit + 1);
+    if (error_pos <= DATA_BITS) {
         data[(error_pos - 1) / 8] ^= (1 << ((error_pos - 1) % 8));
         return error_pos; // Return position of corrected error
     }
-    return 0; // No error or error not correctable
+    return HAMMING_UNCORRECTABLE; // Error not correctable
 }
 
 // Example function to simulate storing and retrieving parity bits
-void storeParityExternally(UInt8 *parity) {
+void storeParityExternally(UInt8 *parity, uint32_t dataSize) {
+    const uint32_t PARITY_BITS = getParityBits(dataSize);
     printf("Stored parity bits: ");
     for (uint32_t i = 0; i < (PARITY_BITS / 8) + (PARITY_BITS % 8 != 0); i++) {
         printf("%02x ", parity[i]);
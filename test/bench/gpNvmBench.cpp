@@ -0,0 +1,292 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+extern "C" {
+    #include "gpNvm.h"
+    #include "flash.h"
+    #include "gpNvmMap.h"
+    #include "gpNvmCompress.h"
+    #include "hamming.h"
+}
+
+extern uint8_t * Memory;
+
+// Number of attribute writes per measurement
+static const uint32_t benchWrites = 96;
+
+/**
+ * Measures write throughput against number of banks using simulated flash timing.
+ * Writes go round-robin over all blocks of the map, each block resides in separate page.
+ */
+static void benchBanks(void) {
+    uint8_t data[0xFF];
+    double baseThroughput = 0;
+
+    std::cout << "Write throughput vs bank count (" << benchWrites << " writes, "
+              << GPNVM_BLOCKS << " blocks)" << std::endl;
+    std::cout << std::setw(8) << "banks" << std::setw(16) << "time [ms]"
+              << std::setw(16) << "writes/s" << std::setw(10) << "speedup" << std::endl;
+
+    for (uint8_t banks = 1; banks <= GPNVM_BLOCKS; banks++) {
+        MemoryInit();
+        if (gpNvm_Init(FlashDrivers, banks) != 0) {
+            std::cout << "gpNvm_Init failed for " << (int)banks << " banks" << std::endl;
+            return;
+        }
+        uint64_t start = flashGetTime();
+        for (uint32_t i = 0; i < benchWrites; i++) {
+            memset(data, (int)i, sizeof(data));
+            gpNvm_SetAttribute((gpNvm_AttrId)(i % GPNVM_BLOCKS), GpNvmMap[i % GPNVM_BLOCKS].length, data);
+        }
+        gpNvm_Sync();
+        double elapsedMs = (double)(flashGetTime() - start) / 1e6;
+        double throughput = benchWrites / (elapsedMs / 1e3);
+        if (banks == 1) {
+            baseThroughput = throughput;
+        }
+        std::cout << std::setw(8) << (int)banks << std::setw(16) << std::fixed << std::setprecision(1)
+                  << elapsedMs << std::setw(16) << throughput << std::setw(9) << std::setprecision(2)
+                  << throughput / baseThroughput << "x" << std::endl;
+    }
+}
+
+typedef uint16_t (*Codec)(const UInt8 *src, uint16_t srcLength, UInt8 *dst, uint16_t dstCapacity);
+
+// Average time of single codec call in nanoseconds
+static double timeCodec(Codec codec, const UInt8 * src, uint16_t srcLength, UInt8 * dst, uint16_t * result) {
+    const uint32_t rounds = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        *result = codec(src, srcLength, dst, 0xFF);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / rounds;
+}
+
+/**
+ * Measures compression ratio and CPU cost of codecs on typical attribute payloads.
+ * Ratio is raw size over encoded size, '-' marks data the codec cannot shrink.
+ */
+static void benchCompression(void) {
+    const uint16_t length = 0xFF;
+    UInt8 sparse[length] = {0};
+    UInt8 text[length];
+    UInt8 counters[length];
+    UInt8 noise[length];
+    std::mt19937 gen(1);
+
+    for (uint16_t i = 0; i < length; i += 24) {
+        sparse[i] = (UInt8)gen();
+    }
+    const char * pattern = "mode=AUTO;level=3;state=IDLE;";
+    for (uint16_t i = 0; i < length; i++) {
+        text[i] = pattern[i % strlen(pattern)];
+        counters[i] = (UInt8)(i / 4);
+        noise[i] = (UInt8)gen();
+    }
+    struct { const char * name; const UInt8 * data; } sets[] = {
+        { "sparse table", sparse },
+        { "repetitive text", text },
+        { "counter table", counters },
+        { "random", noise },
+    };
+    struct { const char * name; Codec encode; Codec decode; } codecs[] = {
+        { "RLE", compressRle, decompressRle },
+        { "LZ", compressLz, decompressLz },
+    };
+
+    std::cout << std::endl << "Compression of " << length << " byte payloads" << std::endl;
+    std::cout << std::setw(18) << "data" << std::setw(6) << "codec" << std::setw(10) << "size"
+              << std::setw(8) << "ratio" << std::setw(14) << "encode [ns]" << std::setw(14) << "decode [ns]" << std::endl;
+    for (auto & set : sets) {
+        for (auto & codec : codecs) {
+            UInt8 encoded[0xFF];
+            UInt8 decoded[0xFF];
+            uint16_t encodedLength = 0;
+            uint16_t decodedLength = 0;
+            double encodeNs = timeCodec(codec.encode, set.data, length, encoded, &encodedLength);
+            std::cout << std::setw(18) << set.name << std::setw(6) << codec.name;
+            if (encodedLength == 0 || encodedLength >= length) {
+                std::cout << std::setw(10) << "-" << std::setw(8) << "-" << std::setw(14)
+                          << std::fixed << std::setprecision(0) << encodeNs << std::setw(14) << "-" << std::endl;
+                continue;
+            }
+            double decodeNs = timeCodec(codec.decode, encoded, encodedLength, decoded, &decodedLength);
+            if (decodedLength != length || memcmp(decoded, set.data, length) != 0) {
+                std::cout << "  round trip FAILED" << std::endl;
+                continue;
+            }
+            std::cout << std::setw(10) << encodedLength << std::setw(8) << std::fixed << std::setprecision(2)
+                      << (double)length / encodedLength << std::setw(14) << std::setprecision(0) << encodeNs
+                      << std::setw(14) << decodeNs << std::endl;
+        }
+    }
+}
+
+/**
+ * Measures flash operations for producers updating the same attributes at high rate:
+ * counter in block 0 at 500 Hz and state blob in block 1 at 100 Hz, for 2 s.
+ */
+static void benchWriteCache(void) {
+    const uint32_t durationMs = 2000;
+    struct { const char * name; uint32_t holdTime; UInt8 dirtyLimit; } configs[] = {
+        { "write-through", 0, 0 },
+        { "hold 100 ms", 100, GPNVM_BLOCKS },
+        { "hold 1000 ms", 1000, GPNVM_BLOCKS },
+    };
+
+    std::cout << std::endl << "Repeated updates, counter at 500 Hz and state at 100 Hz for "
+              << durationMs / 1000 << " s" << std::endl;
+    std::cout << std::setw(16) << "cache" << std::setw(10) << "sets" << std::setw(10) << "erases"
+              << std::setw(10) << "programs" << std::setw(12) << "erases/s" << std::setw(12) << "programs/s" << std::endl;
+    for (auto & config : configs) {
+        UInt8 state[0xFF] = {0};
+        uint32_t counter = 0;
+        uint32_t sets = 0;
+        uint32_t erases = 0;
+        uint32_t programs = 0;
+
+        MemoryInit();
+        gpNvm_Init(FlashDrivers, 1);
+        gpNvm_ConfigureWriteCache(config.holdTime, config.dirtyLimit);
+        for (uint32_t now = 0; now < durationMs; now++) {
+            gpNvm_Process(now);
+            if (now % 2 == 0) {
+                counter++;
+                gpNvm_SetAttribute(0, sizeof(counter), (UInt8 *)&counter);
+                sets++;
+            }
+            if (now % 10 == 0) {
+                state[now % sizeof(state)]++;
+                gpNvm_SetAttribute(1, sizeof(state), state);
+                sets++;
+            }
+        }
+        gpNvm_Flush();
+        flashGetCounters(&erases, &programs);
+        std::cout << std::setw(16) << config.name << std::setw(10) << sets << std::setw(10) << erases
+                  << std::setw(10) << programs << std::setw(12) << std::fixed << std::setprecision(1)
+                  << erases * 1000.0 / durationMs << std::setw(12) << programs * 1000.0 / durationMs << std::endl;
+    }
+}
+
+/**
+ * Measures get/set latency against flash size. CPU time is measured on host,
+ * flash time is simulated flash time of set and get pair in single bank.
+ */
+static void benchFlashSize(void) {
+    const uint32_t rounds = 100;
+    const uint32_t sizes[] = { 8u << 10, 64u << 10, 1u << 20, 8u << 20, 64u << 20 };
+
+    std::cout << std::endl << "Latency vs flash size (" << FLASH_PAGE_SIZE << " byte pages, "
+              << rounds << " rounds)" << std::endl;
+    std::cout << std::setw(12) << "flash" << std::setw(10) << "pages" << std::setw(14) << "set [us]"
+              << std::setw(14) << "get [us]" << std::setw(16) << "flash [ms]" << std::endl;
+    for (uint32_t size : sizes) {
+        UInt8 data[0xFF];
+        UInt8 length = 0;
+        uint32_t pageCount = size / FLASH_PAGE_SIZE;
+
+        MemoryInitGeometry(FLASH_PAGE_SIZE, pageCount, 1);
+        if (gpNvm_Init(FlashDrivers, 1) != 0) {
+            std::cout << "gpNvm_Init failed for " << size << " bytes" << std::endl;
+            return;
+        }
+        auto setTime = std::chrono::steady_clock::duration::zero();
+        auto getTime = std::chrono::steady_clock::duration::zero();
+        uint64_t flashStart = flashGetTime();
+        for (uint32_t i = 0; i < rounds; i++) {
+            gpNvm_AttrId attrId = (gpNvm_AttrId)(i % GPNVM_BLOCKS);
+            memset(data, (int)i, sizeof(data));
+            auto start = std::chrono::steady_clock::now();
+            gpNvm_SetAttribute(attrId, GpNvmMap[attrId].length, data);
+            auto middle = std::chrono::steady_clock::now();
+            gpNvm_GetAttribute(attrId, &length, data);
+            getTime += std::chrono::steady_clock::now() - middle;
+            setTime += middle - start;
+        }
+        gpNvm_Sync();
+        double flashMs = (double)(flashGetTime() - flashStart) / 1e6 / rounds;
+        std::cout << std::setw(10) << (size >> 10) << "KB" << std::setw(10) << pageCount << std::setw(14)
+                  << std::fixed << std::setprecision(1)
+                  << std::chrono::duration_cast<std::chrono::nanoseconds>(setTime).count() / 1e3 / rounds
+                  << std::setw(14)
+                  << std::chrono::duration_cast<std::chrono::nanoseconds>(getTime).count() / 1e3 / rounds
+                  << std::setw(16) << flashMs << std::endl;
+    }
+}
+
+/**
+ * Measures whole-device verification time against number of worker threads.
+ * Device is filled with random data with valid parity (ECC region at the end of bank),
+ * few single bit errors are injected before every run.
+ */
+static void benchVerify(void) {
+    const uint32_t size = 8u << 20;
+    const uint32_t pageCount = size / FLASH_PAGE_SIZE;
+    const uint32_t errors = 8;
+    const uint8_t threads[] = { 1, 2, 4, 8 };
+    std::mt19937 gen(1);
+    double baseTime = 0;
+
+    MemoryInitGeometry(FLASH_PAGE_SIZE, pageCount, 1);
+    if (gpNvm_Init(FlashDrivers, 1) != 0) {
+        std::cout << "gpNvm_Init failed for " << size << " bytes" << std::endl;
+        return;
+    }
+    uint32_t dataPages = gpNvm_GetPageCount();
+    uint32_t paritySize = getParitySize(FLASH_PAGE_SIZE);
+    uint32_t parityPerPage = FLASH_PAGE_SIZE / paritySize;
+    UInt8 * parity = &Memory[(size_t)dataPages * FLASH_PAGE_SIZE];
+    for (uint32_t i = 0; i < dataPages * FLASH_PAGE_SIZE; i++) {
+        Memory[i] = (UInt8)gen();
+    }
+    for (uint32_t page = 0; page < dataPages; page++) {
+        // Every ECC page holds whole parity entries only
+        calculateParityBits(&Memory[(size_t)page * FLASH_PAGE_SIZE], FLASH_PAGE_SIZE,
+                            &parity[(page / parityPerPage) * FLASH_PAGE_SIZE + (page % parityPerPage) * paritySize]);
+    }
+    std::vector<gpNvm_PageHealth> report(dataPages);
+
+    std::cout << std::endl << "Verify time vs threads (" << (size >> 20) << "MB, " << dataPages << " pages, "
+              << errors << " errors, " << std::thread::hardware_concurrency() << " cores)" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "time [ms]" << std::setw(12) << "corrected"
+              << std::setw(10) << "speedup" << std::endl;
+    for (uint8_t count : threads) {
+        for (uint32_t i = 0; i < errors; i++) {
+            uint32_t page = (uint32_t)(gen() % dataPages);
+            Memory[(size_t)page * FLASH_PAGE_SIZE + gen() % FLASH_PAGE_SIZE] ^= 0x01;
+        }
+        auto start = std::chrono::steady_clock::now();
+        gpNvm_Result res = gpNvm_VerifyAll(count, report.data(), (uint32_t)report.size());
+        double time = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start).count() / 1e3;
+        uint32_t corrected = 0;
+        for (gpNvm_PageHealth health : report) {
+            corrected += health == GPNVM_PAGE_CORRECTED;
+        }
+        if (res != 0) {
+            std::cout << "gpNvm_VerifyAll failed for " << (int)count << " threads" << std::endl;
+            return;
+        }
+        if (count == 1) {
+            baseTime = time;
+        }
+        std::cout << std::setw(8) << (int)count << std::setw(14) << std::fixed << std::setprecision(1) << time
+                  << std::setw(12) << corrected << std::setw(9) << std::setprecision(2) << baseTime / time
+                  << "x" << std::endl;
+    }
+}
+
+int main() {
+    benchBanks();
+    benchCompression();
+    benchWriteCache();
+    benchFlashSize();
+    benchVerify();
+    return 0;
+}
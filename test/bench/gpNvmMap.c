@@ -0,0 +1,38 @@
+/**
+ **********************************************************************************
+ * File: [gpNvmMap.c]
+ * Author: [Maciej Sliwinski]
+ * Description: [Non-volatile memory storage component]
+ *
+ * Copyright (c) 2024 Maciej Sliwinski. All rights reserved.
+ * 
+ * This software is provided "as is" without any warranties.
+ */
+
+#include "gpNvmMap.h"
+
+const gpNvmBlock GpNvmMap[GPNVM_BLOCKS] =
+{
+    // ******************************************
+    // ****** PUT YOUR CODE HERE **** START *****
+    // ******************************************
+    // Every block in separate page, so blocks may reside in different banks
+    {
+        // ******** Block 0 ********
+        .startAddr = (UInt8 *)0x80000,
+        .length = 0xFF,
+    },
+    {
+        // ******** Block 1 ********
+        .startAddr = (UInt8 *)0x80800,
+        .length = 0xFF,
+    },
+    {
+        // ******** Block 2 ********
+        .startAddr = (UInt8 *)0x81000,
+        .length = 0xFF,
+    },
+    // ******************************************
+    // ****** PUT YOUR CODE HERE **** END *******
+    // ******************************************
+};
@@ -11,11 +11,7 @@
 
 #include "../include/gpNvmMap.h"
 
-#ifdef GPNVM_USE_ECC
-    const gpNvmBlock GpNvmMap[GPNVM_BLOCKS + 1] =
-#else
-    const gpNvmBlock GpNvmMap[GPNVM_BLOCKS] =
-#endif /* ifdef GPNVM_USE_ECC */
+const gpNvmBlock GpNvmMap[GPNVM_BLOCKS] =
 {
     // ******************************************
     // ****** PUT YOUR CODE HERE **** START *****
@@ -24,6 +20,8 @@
         // ******** Block 0 ********
         .startAddr = (UInt8 *)0x80000,
         .length = 0xA0,
+        .compression = GPNVM_COMPRESSION_AUTO,
+        .maxLength = 0xF0,
     },
     {
         // ******** Block 1 ********
@@ -38,11 +36,4 @@
     // ******************************************
     // ****** PUT YOUR CODE HERE **** END *******
     // ******************************************
-#ifdef GPNVM_USE_ECC
-    {
-        // ******** Block for redundancy bits ECC ********
-        .startAddr = (UInt8 *)GPNVM_FLASH_END - 0xFF,
-        .length = 0xFF,
-    },
-#endif /* ifdef GPNVM_USE_ECC */
 };
@@ -1,10 +1,12 @@
 #include "gtest/gtest.h"
 #include <iostream>
 #include <random>
+#include <vector>
 extern "C" {
     #include "../include/gpNvm.h"
     #include "./flash.h"
     #include "../include/gpNvmMap.h"
+    #include "../include/hamming.h"
 }
 void testSetup();
 void testExit();
@@ -12,7 +14,7 @@ void testExit();
 std::random_device rd;
 std::mt19937 gen(rd());
 
-extern uint8_t Memory[];
+extern uint8_t * Memory;
 
 int getRandomNum(int range) {
     std::uniform_int_distribution<> dist(0, range);
@@ -22,6 +24,7 @@ int getRandomNum(int range) {
 void testSetup() {
     readFromFile();
     MemoryInit();
+    gpNvm_Init(FlashDrivers, 1);
 }
 
 void testExit() {
@@ -104,9 +107,473 @@ TEST(EccTest, Test) {
     // Compare saved flipped byte with data from memory
     EXPECT_NE(flippedByte, readData[randomNum]);
 
+    // Double bit error cannot be corrected, corrupted data is not returned
+    blockMemoryPtr[0] ^= 0x01;
+    blockMemoryPtr[1] ^= 0x01;
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_NE(nvmResult, 0);
+    nvmResult = gpNvm_SetAttribute(blockNo, blockSize, writeData);
+    EXPECT_NE(nvmResult, 0);
+
+    testExit();
+}
+
+TEST(MultiBankTest, Test) {
+    testSetup();
+
+    gpNvm_Result nvmResult;
+    const uint8_t banks = 2;
+    // Block 2 resides in logical page 1, thus in bank 1 at its first page
+    uint8_t blockNo = 2;
+    const uint32_t blockSize = 0x80;
+    uint8_t writeData[blockSize] = {0};
+    uint8_t readData[blockSize] = {0};
+    uint8_t * bank1MemoryPtr = &Memory[FLASH_SIZE];
+    uint8_t len = 0;
+
+    nvmResult = gpNvm_Init(FlashDrivers, banks);
+    EXPECT_EQ(nvmResult, 0);
+
+    for (size_t i = 0; i < sizeof(writeData); i++) {
+        writeData[i] = getRandomNum(0xFF);
+    }
+
+    nvmResult = gpNvm_SetAttribute(blockNo, blockSize, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    // Verify block landed in bank 1
+    EXPECT_EQ(memcmp(writeData, bank1MemoryPtr, blockSize), 0);
+
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(len, blockSize);
+    EXPECT_EQ(memcmp(readData, writeData, blockSize), 0);
+
+    // Block 1 stays in bank 0
+    nvmResult = gpNvm_SetAttribute(1, blockSize, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(writeData, &Memory[0x100], blockSize), 0);
+
+    EXPECT_EQ(gpNvm_Sync(), 0);
+
+    testExit();
+}
+
+TEST(CompressionTest, Test) {
+    testSetup();
+
+    gpNvm_Result nvmResult;
+    // Block 0 is compressed, holds 0xA0 bytes and values up to 0xF0 bytes
+    uint8_t blockNo = 0;
+    const uint32_t blockSize = 0xA0;
+    const uint32_t valueSize = 0xF0;
+    uint8_t writeData[0xFF] = {0};
+    uint8_t readData[0xFF] = {0};
+    uint8_t * blockMemoryPtr = &Memory[0];
+    uint8_t len = 0;
+
+    // Sparse table longer than the block itself
+    for (size_t i = 0; i < valueSize; i += 0x20) {
+        writeData[i] = getRandomNum(0xFF);
+    }
+    nvmResult = gpNvm_SetAttribute(blockNo, valueSize, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    // Tail of block is left erased
+    EXPECT_EQ(blockMemoryPtr[blockSize - 1], 0xFF);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(len, valueSize);
+    EXPECT_EQ(memcmp(readData, writeData, valueSize), 0);
+
+    // Repetitive string
+    const char * text = "state=IDLE;state=IDLE;state=BUSY;state=IDLE;state=IDLE;state=BUSY;";
+    nvmResult = gpNvm_SetAttribute(blockNo, strlen(text), (uint8_t *)text);
+    EXPECT_EQ(nvmResult, 0);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(len, strlen(text));
+    EXPECT_EQ(memcmp(readData, text, strlen(text)), 0);
+
+    // RLE runs out of space after emitting literals, nothing but header and LZ stream is programmed
+    const char * pattern = "mode=AUTO;level=3;state=IDLE;";
+    for (size_t i = 0; i < valueSize; i++) {
+        writeData[i] = pattern[i % strlen(pattern)];
+    }
+    nvmResult = gpNvm_SetAttribute(blockNo, valueSize, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(blockMemoryPtr[0], GPNVM_COMPRESSION_LZ);
+    for (uint32_t i = 2 + blockMemoryPtr[1]; i < blockSize; i++) {
+        EXPECT_EQ(blockMemoryPtr[i], 0xFF);
+    }
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(readData, writeData, valueSize), 0);
+
+    // Random data does not compress, it is stored raw if it fits with header
+    for (size_t i = 0; i < valueSize; i++) {
+        writeData[i] = getRandomNum(0xFF);
+    }
+    nvmResult = gpNvm_SetAttribute(blockNo, blockSize - 2, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(&blockMemoryPtr[2], writeData, blockSize - 2), 0);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(len, blockSize - 2);
+    EXPECT_EQ(memcmp(readData, writeData, blockSize - 2), 0);
+
+    nvmResult = gpNvm_SetAttribute(blockNo, valueSize, writeData);
+    EXPECT_NE(nvmResult, 0);
+
+    // Value longer than maximal length of block is rejected even if it compresses
+    memset(writeData, 0, sizeof(writeData));
+    nvmResult = gpNvm_SetAttribute(blockNo, valueSize + 1, writeData);
+    EXPECT_NE(nvmResult, 0);
+
+    // Stored stream decoding to 250 bytes does not overflow read buffer of 0xF0 bytes
+    const uint8_t forged[] = {GPNVM_COMPRESSION_RLE, 4, 0xFF, 0xAA, 0xF5, 0xAA};
+    memcpy(blockMemoryPtr, forged, sizeof(forged));
+    calculateParityBits(blockMemoryPtr, FLASH_PAGE_SIZE, &Memory[3 * FLASH_PAGE_SIZE]);
+    memset(readData, 0x55, sizeof(readData));
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_NE(nvmResult, 0);
+    for (uint32_t i = valueSize; i < sizeof(readData); i++) {
+        EXPECT_EQ(readData[i], 0x55);
+    }
+
     testExit();
 }
 
+#ifdef GPNVM_USE_WRITE_CACHE
+// Bank 0 driver whose program of given page fails given number of times
+static gpNvm_FlashDriver FailingDriver;
+static uint32_t FailingPrograms = 0;
+static uintptr_t FailingPage = FLASH_START;
+
+static UInt8 failingProgram(void * ctx, UInt8 * addr, UInt8 * data, uint16_t length) {
+    if (FailingPrograms > 0 && (uintptr_t)addr >= FailingPage && (uintptr_t)addr < FailingPage + FLASH_PAGE_SIZE) {
+        FailingPrograms--;
+        return 1;
+    }
+    return FlashDrivers[0].program(ctx, addr, data, length);
+}
+
+TEST(WriteCacheTest, Test) {
+    testSetup();
+
+    gpNvm_Result nvmResult;
+    uint8_t blockNo = 1;
+    const uint32_t blockSize = 0xFF;
+    uint8_t writeData[blockSize] = {0};
+    uint8_t readData[blockSize] = {0};
+    uint8_t * blockMemoryPtr = &Memory[0x80100 - GPNVM_FLASH_START];
+    uint8_t len = 0;
+    uint32_t erases = 0;
+    uint32_t programs = 0;
+    uint32_t erasesBefore = 0;
+
+    // Dirty limit is bound by cache pool
+    nvmResult = gpNvm_ConfigureWriteCache(100, GPNVM_CACHE_ENTRIES + 1);
+    EXPECT_NE(nvmResult, 0);
+    // Hold values for 100 time units, at most 2 dirty attributes
+    nvmResult = gpNvm_ConfigureWriteCache(100, 2);
+    EXPECT_EQ(nvmResult, 0);
+
+    for (uint32_t i = 0; i < 50; i++) {
+        memset(writeData, (int)i, sizeof(writeData));
+        nvmResult = gpNvm_SetAttribute(blockNo, blockSize, writeData);
+        EXPECT_EQ(nvmResult, 0);
+        EXPECT_EQ(gpNvm_Process(i), 0);
+    }
+    // Nothing programmed yet, latest value is read back
+    EXPECT_NE(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(readData, writeData, blockSize), 0);
+
+    // Hold time elapsed, only latest value is programmed
+    flashGetCounters(&erasesBefore, &programs);
+    EXPECT_EQ(gpNvm_Process(100), 0);
+    EXPECT_EQ(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+    flashGetCounters(&erases, &programs);
+    // Data page and parity page
+    EXPECT_EQ(erases - erasesBefore, 2u);
+
+    // Exceeding dirty limit programs attribute dirty for longest time
+    nvmResult = gpNvm_SetAttribute(blockNo, blockSize, readData);
+    EXPECT_EQ(gpNvm_Process(110), 0);
+    nvmResult = gpNvm_SetAttribute(2, 0x80, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    flashGetCounters(&erasesBefore, &programs);
+    nvmResult = gpNvm_SetAttribute(0, 0x10, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    flashGetCounters(&erases, &programs);
+    EXPECT_EQ(erases - erasesBefore, 2u);
+    // Block 1 was dirty for longest time and got programmed, block 2 is still held
+    EXPECT_NE(memcmp(writeData, &Memory[0x80800 - GPNVM_FLASH_START], 0x80), 0);
+
+    // Flush programs everything left
+    EXPECT_EQ(gpNvm_Flush(), 0);
+    EXPECT_EQ(memcmp(writeData, &Memory[0x80800 - GPNVM_FLASH_START], 0x80), 0);
+    nvmResult = gpNvm_GetAttribute(0, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(len, 0x10);
+
+    // Lowering limit programs only oldest values until it is met
+    memset(writeData, 0x33, sizeof(writeData));
+    EXPECT_EQ(gpNvm_SetAttribute(2, 0x80, writeData), 0);
+    EXPECT_EQ(gpNvm_Process(120), 0);
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, blockSize, writeData), 0);
+    EXPECT_EQ(gpNvm_ConfigureWriteCache(100, 1), 0);
+    EXPECT_EQ(memcmp(writeData, &Memory[0x80800 - GPNVM_FLASH_START], 0x80), 0);
+    EXPECT_NE(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+
+    EXPECT_EQ(gpNvm_ConfigureWriteCache(0, 0), 0);
+    EXPECT_EQ(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+
+    // Shorter value held after longer one keeps tail of the longer one
+    uint8_t expected[10] = {0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+    EXPECT_EQ(gpNvm_ConfigureWriteCache(100, 2), 0);
+    memset(writeData, 0xAA, 10);
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, 10, writeData), 0);
+    memset(writeData, 0xBB, 5);
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, 5, writeData), 0);
+    EXPECT_EQ(gpNvm_Flush(), 0);
+    EXPECT_EQ(memcmp(expected, blockMemoryPtr, sizeof(expected)), 0);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(expected, readData, sizeof(expected)), 0);
+    EXPECT_EQ(gpNvm_ConfigureWriteCache(0, 0), 0);
+
+    // Value stays cached when its page cannot be programmed
+    MemoryInit();
+    // Memory is reallocated
+    blockMemoryPtr = &Memory[0x80100 - GPNVM_FLASH_START];
+    FailingDriver = FlashDrivers[0];
+    FailingDriver.program = failingProgram;
+    EXPECT_EQ(gpNvm_Init(&FailingDriver, 1), 0);
+    // Page of block 1 and page of block 2 hold data, their parity shares ECC page
+    memset(writeData, 0x11, sizeof(writeData));
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, blockSize, writeData), 0);
+    memset(writeData, 0x22, sizeof(writeData));
+    EXPECT_EQ(gpNvm_SetAttribute(2, 0x80, writeData), 0);
+    EXPECT_EQ(gpNvm_ConfigureWriteCache(100, 2), 0);
+
+    // Transient failure is retried
+    memset(writeData, 0x33, sizeof(writeData));
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, blockSize, writeData), 0);
+    FailingPage = FLASH_START;
+    FailingPrograms = 1;
+    EXPECT_EQ(gpNvm_Flush(), 0);
+    EXPECT_EQ(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+
+    // ECC page left erased, parity of both pages is regenerated from data
+    memset(writeData, 0x5A, sizeof(writeData));
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, blockSize, writeData), 0);
+    FailingPage = FLASH_START + 3 * FLASH_PAGE_SIZE;
+    FailingPrograms = GPNVM_PROGRAM_ATTEMPTS;
+    EXPECT_NE(gpNvm_Flush(), 0);
+    nvmResult = gpNvm_GetAttribute(2, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(readData[0], 0x22);
+    EXPECT_EQ(readData[0x7F], 0x22);
+    EXPECT_EQ(gpNvm_Flush(), 0);
+    EXPECT_EQ(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+
+    // Data page left erased after parity was updated, parity follows page contents
+    memset(writeData, 0xA5, sizeof(writeData));
+    EXPECT_EQ(gpNvm_SetAttribute(blockNo, blockSize, writeData), 0);
+    FailingPage = FLASH_START;
+    FailingPrograms = GPNVM_PROGRAM_ATTEMPTS;
+    EXPECT_NE(gpNvm_Flush(), 0);
+    nvmResult = gpNvm_GetAttribute(2, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(readData[0], 0x22);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(readData, writeData, blockSize), 0);
+    EXPECT_EQ(gpNvm_Flush(), 0);
+    EXPECT_EQ(gpNvm_ConfigureWriteCache(0, 0), 0);
+    EXPECT_EQ(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(readData, writeData, blockSize), 0);
+    nvmResult = gpNvm_GetAttribute(2, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(readData[0], 0x22);
+
+    testExit();
+}
+#endif /* ifdef GPNVM_USE_WRITE_CACHE */
+
+TEST(GeometryTest, Test) {
+    gpNvm_Result nvmResult;
+    // 4 KB pages, 64 KB bank
+    const uint16_t pageSize = 0x1000;
+    const uint32_t pageCount = 16;
+    uint8_t blockNo = 1;
+    const uint32_t blockSize = 0xFF;
+    uint8_t writeData[blockSize] = {0};
+    uint8_t readData[blockSize] = {0};
+    uint8_t len = 0;
+
+    MemoryInitGeometry(pageSize, pageCount, 1);
+    nvmResult = gpNvm_Init(FlashDrivers, 1);
+    EXPECT_EQ(nvmResult, 0);
+    // Memory is reallocated with new geometry
+    uint8_t * blockMemoryPtr = &Memory[0x80100 - GPNVM_FLASH_START];
+
+    for (size_t i = 0; i < sizeof(writeData); i++) {
+        writeData[i] = getRandomNum(0xFF);
+    }
+    nvmResult = gpNvm_SetAttribute(blockNo, blockSize, writeData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(writeData, blockMemoryPtr, blockSize), 0);
+    // Parity of page 0 resides at start of last page
+    uint8_t * parityPtr = &Memory[(pageCount - 1) * pageSize];
+    EXPECT_FALSE(parityPtr[0] == 0xFF && parityPtr[1] == 0xFF);
+
+    // Single bit error in 4 KB page is corrected
+    uint8_t randomNum = getRandomNum(blockSize - 1);
+    blockMemoryPtr[randomNum] ^= 0x80;
+    nvmResult = gpNvm_GetAttribute(blockNo, &len, readData);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(memcmp(readData, writeData, blockSize), 0);
+
+    // 16-bit attribute ID is not truncated
+    nvmResult = gpNvm_SetAttribute(0x100 + blockNo, blockSize, writeData);
+    EXPECT_NE(nvmResult, 0);
+
+    // 3-byte parity does not divide page, ECC page holds 1365 whole entries
+    const uint32_t largePageCount = 1400;
+    MemoryInitGeometry(pageSize, largePageCount, 1);
+    nvmResult = gpNvm_Init(FlashDrivers, 1);
+    EXPECT_EQ(nvmResult, 0);
+    const uint32_t paritySize = getParitySize(pageSize);
+    const uint32_t parityPerPage = pageSize / paritySize;
+    EXPECT_EQ(paritySize, 3u);
+    // 2 ECC pages hold parity of remaining 1398 pages
+    const uint32_t dataPages = gpNvm_GetPageCount();
+    EXPECT_EQ(dataPages, largePageCount - 2);
+    std::vector<gpNvm_PageHealth> report(dataPages);
+    // Last entry of first ECC page and first entry of second one
+    for (uint32_t page = parityPerPage - 1; page <= parityPerPage; page++) {
+        uint8_t * pagePtr = &Memory[(size_t)page * pageSize];
+        uint8_t * entryPtr = &Memory[(size_t)(dataPages + page / parityPerPage) * pageSize +
+                                        (page % parityPerPage) * paritySize];
+        uint8_t parity[3] = {0};
+        for (uint32_t i = 0; i < pageSize; i++) {
+            pagePtr[i] = getRandomNum(0xFF);
+        }
+        calculateParityBits(pagePtr, pageSize, parity);
+        memcpy(entryPtr, parity, sizeof(parity));
+        pagePtr[getRandomNum(pageSize - 1)] ^= 0x02;
+    }
+    nvmResult = gpNvm_VerifyAll(2, report.data(), dataPages);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(report[parityPerPage - 1], GPNVM_PAGE_CORRECTED);
+    EXPECT_EQ(report[parityPerPage], GPNVM_PAGE_CORRECTED);
+    EXPECT_EQ(report[0], GPNVM_PAGE_OK);
+
+    // Page larger than supported is rejected
+    MemoryInitGeometry(GPNVM_MAX_PAGE_SIZE * 2, 4, 1);
+    EXPECT_NE(gpNvm_Init(FlashDrivers, 1), 0);
+    // Map does not fit in bank, block 2 would reside in ECC page
+    MemoryInitGeometry(FLASH_PAGE_SIZE, 2, 1);
+    EXPECT_NE(gpNvm_Init(FlashDrivers, 1), 0);
+}
+
+TEST(VerifyTest, Test) {
+    gpNvm_Result nvmResult;
+    const uint8_t banks = 2;
+    const uint32_t blockSize = 0x80;
+    uint8_t writeData[blockSize] = {0};
+    gpNvm_PageHealth report[8] = {0};
+
+    MemoryInitGeometry(FLASH_PAGE_SIZE, FLASH_SIZE / FLASH_PAGE_SIZE, banks);
+    nvmResult = gpNvm_Init(FlashDrivers, banks);
+    EXPECT_EQ(nvmResult, 0);
+    // 3 data pages and ECC page in every bank
+    const uint32_t pageCount = gpNvm_GetPageCount();
+    EXPECT_EQ(pageCount, 6u);
+
+    for (size_t i = 0; i < sizeof(writeData); i++) {
+        writeData[i] = getRandomNum(0xFF);
+    }
+    // Logical page 0 in bank 0, logical page 1 in bank 1
+    EXPECT_EQ(gpNvm_SetAttribute(1, blockSize, writeData), 0);
+    EXPECT_EQ(gpNvm_SetAttribute(2, blockSize, writeData), 0);
+    EXPECT_EQ(gpNvm_Sync(), 0);
+    uint8_t * page0Ptr = &Memory[0x100];
+    uint8_t * page1Ptr = &Memory[FLASH_SIZE];
+
+    // Freshly programmed and never programmed pages are fine
+    nvmResult = gpNvm_VerifyAll(4, report, pageCount);
+    EXPECT_EQ(nvmResult, 0);
+    for (uint32_t i = 0; i < pageCount; i++) {
+        EXPECT_EQ(report[i], GPNVM_PAGE_OK);
+    }
+
+    // Single bit error in both banks is found without reading attributes
+    page0Ptr[getRandomNum(blockSize - 1)] ^= 0x04;
+    page1Ptr[getRandomNum(blockSize - 1)] ^= 0x40;
+    nvmResult = gpNvm_VerifyAll(4, report, pageCount);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(report[0], GPNVM_PAGE_CORRECTED);
+    EXPECT_EQ(report[1], GPNVM_PAGE_CORRECTED);
+    for (uint32_t i = 2; i < pageCount; i++) {
+        EXPECT_EQ(report[i], GPNVM_PAGE_OK);
+    }
+    // Corrected pages are written back
+    EXPECT_EQ(memcmp(writeData, page0Ptr, blockSize), 0);
+    EXPECT_EQ(memcmp(writeData, page1Ptr, blockSize), 0);
+    nvmResult = gpNvm_VerifyAll(1, report, pageCount);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(report[0], GPNVM_PAGE_OK);
+    EXPECT_EQ(report[1], GPNVM_PAGE_OK);
+
+    // Error in parity bits of page 0 (ECC page is last page of bank) rewrites parity only
+    uint8_t * parityPtr = &Memory[3 * FLASH_PAGE_SIZE];
+    uint8_t parityBackup[2] = {parityPtr[0], parityPtr[1]};
+    parityPtr[getRandomNum(1)] ^= (uint8_t)(1 << getRandomNum(7));
+    nvmResult = gpNvm_VerifyAll(4, report, pageCount);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(report[0], GPNVM_PAGE_PARITY_CORRECTED);
+    EXPECT_EQ(memcmp(writeData, page0Ptr, blockSize), 0);
+    EXPECT_EQ(memcmp(parityBackup, parityPtr, sizeof(parityBackup)), 0);
+
+    // Double error is detected and left untouched
+    page0Ptr[0] ^= 0x01;
+    page0Ptr[1] ^= 0x10;
+    nvmResult = gpNvm_VerifyAll(4, report, pageCount);
+    EXPECT_EQ(nvmResult, 0);
+    EXPECT_EQ(report[0], GPNVM_PAGE_UNCORRECTABLE);
+    EXPECT_EQ(page0Ptr[0], writeData[0] ^ 0x01);
+    EXPECT_EQ(page0Ptr[1], writeData[1] ^ 0x10);
+
+    // Uncorrectable page fails until it is erased with its parity
+    uint8_t readData[0xFF] = {0};
+    uint8_t len = 0;
+    EXPECT_NE(gpNvm_GetAttribute(1, &len, readData), 0);
+    EXPECT_NE(gpNvm_SetAttribute(1, blockSize, writeData), 0);
+    EXPECT_EQ(gpNvm_ErasePage(0), 0);
+    nvmResult = gpNvm_VerifyAll(4, report, pageCount);
+    EXPECT_EQ(nvmResult, 0);
+    for (uint32_t i = 0; i < pageCount; i++) {
+        EXPECT_EQ(report[i], GPNVM_PAGE_OK);
+    }
+    EXPECT_EQ(gpNvm_GetAttribute(1, &len, readData), 0);
+    EXPECT_EQ(readData[0], 0xFF);
+    EXPECT_EQ(gpNvm_SetAttribute(1, blockSize, writeData), 0);
+    EXPECT_EQ(gpNvm_GetAttribute(1, &len, readData), 0);
+    EXPECT_EQ(memcmp(writeData, readData, blockSize), 0);
+    // Page of other bank is left intact
+    EXPECT_EQ(gpNvm_GetAttribute(2, &len, readData), 0);
+    EXPECT_EQ(memcmp(writeData, readData, blockSize), 0);
+    EXPECT_NE(gpNvm_ErasePage(pageCount), 0);
+
+    // Report must hold every page
+    EXPECT_NE(gpNvm_VerifyAll(4, report, pageCount - 1), 0);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();